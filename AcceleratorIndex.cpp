@@ -0,0 +1,75 @@
+#include "AcceleratorIndex.hpp"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFDebugPubTable.h"
+#include "llvm/DebugInfo/DWARF/DWARFUnit.h"
+#include <algorithm>
+#include <utility>
+
+using namespace llvm;
+
+AcceleratorIndex::AcceleratorIndex(DWARFContextInMemory &context)
+{
+    bool gnuStyle = !context.getGnuPubNamesSection().empty();
+    StringRef section = gnuStyle ? context.getGnuPubNamesSection() : context.getPubNamesSection();
+    if (section.empty()) {
+        return;
+    }
+
+    DWARFDebugPubTable table(section, context.isLittleEndian(), gnuStyle);
+    for (auto &set : table.getData()) {
+        DWARFUnit *unit = context.getCompileUnitForOffset(set.Offset);
+        // the unit offsets are not relocated in an object file, so a set can
+        // only be trusted if it describes the unit it points at
+        if (!unit || unit->getOffset() != set.Offset ||
+            unit->getNextUnitOffset() - unit->getOffset() != set.Size) {
+            continue;
+        }
+
+        std::vector<Die::Offset> subprograms;
+        std::vector<std::pair<Die::Offset, Die::Offset> > modules;
+        for (auto &entry : set.Entries) {
+            Die die = Die::atOffset(*unit, set.Offset + entry.SecOffset);
+            if (!die || die.isNULL()) {
+                continue;
+            }
+            if (die.isSubprogramDIE()) {
+                subprograms.push_back(die.getOffset());
+            } else if (die.getTag() == dwarf::DW_TAG_module) {
+                Die sibling = die.getSibling();
+                Die::Offset end = sibling ? sibling.getOffset() : unit->getNextUnitOffset();
+                modules.push_back(std::make_pair(die.getOffset(), end));
+            }
+        }
+
+        auto inModule = [&modules](Die::Offset offset) {
+            for (auto &m : modules) {
+                if (offset > m.first && offset < m.second) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        subprograms.erase(std::remove_if(subprograms.begin(), subprograms.end(), inModule), subprograms.end());
+        std::sort(subprograms.begin(), subprograms.end());
+        subprograms.erase(std::unique(subprograms.begin(), subprograms.end()), subprograms.end());
+        Unit &indexed = units_[set.Offset];
+        indexed.subprograms = std::move(subprograms);
+        for (auto &m : modules) {
+            indexed.modules.push_back(m.first);
+        }
+        std::sort(indexed.modules.begin(), indexed.modules.end());
+        indexed.modules.erase(std::unique(indexed.modules.begin(), indexed.modules.end()), indexed.modules.end());
+    }
+}
+
+const std::vector<Die::Offset> *AcceleratorIndex::subprograms(const DWARFUnit &unit) const
+{
+    auto fit = units_.find(unit.getOffset());
+    return fit == units_.end() ? nullptr : &fit->second.subprograms;
+}
+
+const std::vector<Die::Offset> *AcceleratorIndex::modules(const DWARFUnit &unit) const
+{
+    auto fit = units_.find(unit.getOffset());
+    return fit == units_.end() ? nullptr : &fit->second.modules;
+}
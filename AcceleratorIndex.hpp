@@ -0,0 +1,58 @@
+#ifndef AcceleratorIndex_hpp
+#define AcceleratorIndex_hpp
+
+#include <unordered_map>
+#include <vector>
+#include "Die.hpp"
+
+namespace llvm {
+class DWARFContextInMemory;
+class DWARFUnit;
+}
+
+/**
+ * The subprogram DIEs of each compile unit, read from the name index of an
+ * object file so its units can be extracted without walking every DIE.
+ *
+ * The index is .debug_gnu_pubnames (gcc -ggnu-pubnames, implied by split
+ * DWARF) or .debug_pubnames (-gpubnames).  LLVM 5 has no .debug_names reader
+ * and does not expose the entries of .gdb_index, so those are not used.
+ *
+ * The producer decides what goes in the index, and gcc may leave out
+ * subprograms that are not DW_AT_external.  Those are then missing from the
+ * header, where a full scan would declare them, so the index is only read
+ * with --name-index.
+ * Internal procedures are children of their host and found by neither.
+ *
+ * The index also lists the procedures of Fortran modules.  The full scan only
+ * sees the immediate children of a unit, so subprograms inside the subtree of
+ * an indexed DW_TAG_module are dropped to give the same result otherwise.  The
+ * modules themselves are kept for their variables.
+ */
+class AcceleratorIndex
+{
+public:
+    /// Reads the index of \p context, which is empty if the object has none.
+    explicit AcceleratorIndex(llvm::DWARFContextInMemory &context);
+
+    /**
+     * \return offsets of the top level subprogram DIEs of \p unit in DIE order,
+     * or null if the index does not cover the unit and it must be scanned.
+     */
+    const std::vector<Die::Offset> *subprograms(const llvm::DWARFUnit &unit) const;
+
+    /// \return offsets of the DW_TAG_module DIEs of \p unit, null if the index does not cover it.
+    const std::vector<Die::Offset> *modules(const llvm::DWARFUnit &unit) const;
+
+private:
+    struct Unit
+    {
+        std::vector<Die::Offset> subprograms;
+        std::vector<Die::Offset> modules;
+    };
+
+    /// keyed by unit offset
+    std::unordered_map<Die::Offset, Unit> units_;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "ArrayDescriptor.hpp"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
+#include "llvm/DebugInfo/DWARF/DWARFUnit.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include <stdexcept>
+
+using namespace llvm;
+
+bool ArrayDescriptor::isDescriptor(Die arrayType)
+{
+    return arrayType.find({ dwarf::DW_AT_data_location, dwarf::DW_AT_allocated, dwarf::DW_AT_associated }).hasValue();
+}
+
+namespace {
+
+/**
+ * \return the offset of the first descriptor field read by the expression in
+ * \p attr.  gfortran reads a field with DW_OP_push_object_address,
+ * DW_OP_plus_uconst <offset>, DW_OP_deref, with another DW_OP_deref after
+ * the address if the object is a pointer to the descriptor, as for the
+ * result of an array function.  An upper bound computed from the lower one
+ * reads the upper bound first.  None for anything else, which is left unchecked.
+ */
+Optional<uint64_t> firstField(const Optional<DWARFFormValue> &attr)
+{
+    if (!attr.hasValue()) {
+        return None;
+    }
+    auto expr = attr.getValue().getAsBlock();
+    if (!expr.hasValue()) {
+        return None;
+    }
+    ArrayRef<uint8_t> ops = expr.getValue();
+    size_t i = 0;
+    while (i < ops.size()) {
+        uint8_t op = ops[i++];
+        if (op == dwarf::DW_OP_push_object_address) {
+            if (i < ops.size() && ops[i] == dwarf::DW_OP_deref) {
+                ++i;
+            }
+            if (i + 1 < ops.size() && ops[i] == dwarf::DW_OP_plus_uconst) {
+                return decodeULEB128(ops.data() + i + 1);
+            }
+            return None;
+        } else if (op == dwarf::DW_OP_plus_uconst || op == dwarf::DW_OP_constu) {
+            while (i < ops.size() && (ops[i++] & 0x80)) {
+            }
+        } else if (!((op >= dwarf::DW_OP_lit0 && op <= dwarf::DW_OP_lit31) || op == dwarf::DW_OP_deref ||
+                     op == dwarf::DW_OP_plus || op == dwarf::DW_OP_minus || op == dwarf::DW_OP_mul)) {
+            return None;
+        }
+    }
+    return None;
+}
+
+}
+
+/**
+ * Checks each of the bounds and the byte stride that is an expression
+ * reading the descriptor.  An assumed-shape argument has no lower bound, it
+ * is always 1, so its dimensions are checked through the other two.
+ */
+unsigned ArrayDescriptor::extractRank(Die arrayType)
+{
+    unsigned addressSize = arrayType.getDwarfUnit()->getAddressByteSize();
+    unsigned rank = 0;
+    auto dim = arrayType.getFirstChild();
+    while (dim.isValid() && !dim.isNULL()) {
+        if (dim.getTag() != dwarf::DW_TAG_subrange_type) {
+            throw std::runtime_error("ArrayDescriptor::extractRank--child is not a subrange");
+        }
+        // stride, lower_bound and upper_bound of the rank'th f2h_dim
+        uint64_t dimOffset = size(rank, addressSize);
+        const std::pair<dwarf::Attribute, uint64_t> fields[] = {
+            { dwarf::DW_AT_byte_stride, dimOffset },
+            { dwarf::DW_AT_lower_bound, dimOffset + addressSize },
+            { dwarf::DW_AT_upper_bound, dimOffset + 2 * addressSize },
+        };
+        for (auto &field : fields) {
+            auto offset = firstField(dim.find(field.first));
+            if (offset.hasValue() && offset.getValue() != field.second) {
+                throw std::runtime_error("ArrayDescriptor::extractRank--unsupported array descriptor layout");
+            }
+        }
+        ++rank;
+        dim = dim.getSibling();
+    }
+    if (rank == 0) {
+        throw std::runtime_error("ArrayDescriptor::extractRank--array without dimensions");
+    }
+    return rank;
+}
+
+uint64_t ArrayDescriptor::size(unsigned rank, unsigned addressSize)
+{
+    // base_addr, offset, dtype.elem_len, span and 8 bytes of dtype.version to dtype.attribute
+    return 4 * addressSize + 8 + 3 * addressSize * rank;
+}
+
+void ArrayDescriptor::writeName(raw_ostream &os, unsigned rank)
+{
+    os << "f2h_array_r" << rank;
+}
+
+void ArrayDescriptor::writeSupport(raw_ostream &os)
+{
+    os << R"(#ifndef F2H_ARRAY_DESCRIPTOR
+#define F2H_ARRAY_DESCRIPTOR
+#include <stddef.h>
+
+/* values of f2h_dtype.type */
+#define F2H_TYPE_INTEGER 1
+#define F2H_TYPE_LOGICAL 2
+#define F2H_TYPE_REAL 3
+#define F2H_TYPE_COMPLEX 4
+#define F2H_TYPE_DERIVED 5
+#define F2H_TYPE_CHARACTER 6
+
+typedef struct f2h_dim {
+    ptrdiff_t stride;
+    ptrdiff_t lower_bound;
+    ptrdiff_t upper_bound;
+} f2h_dim;
+
+typedef struct f2h_dtype {
+    size_t elem_len;
+    int version;
+    signed char rank;
+    signed char type;
+    signed short attribute;
+} f2h_dtype;
+#endif
+
+)";
+}
+
+/**
+ * Strides of a descriptor count elements, so the byte strides given to the
+ * function must be multiples of the element length.  The lower bounds are 1,
+ * which is what an assumed-shape argument has inside the callee anyway.
+ */
+void ArrayDescriptor::writeRank(raw_ostream &os, unsigned rank)
+{
+    std::string name;
+    raw_string_ostream ns(name);
+    writeName(ns, rank);
+    ns.flush();
+    std::string guard = "F2H_ARRAY_R" + std::to_string(rank);
+
+    os << "#ifndef " << guard << "\n#define " << guard << "\n"
+    "typedef struct " << name << " {\n"
+    "    void *base_addr;\n"
+    "    ptrdiff_t offset;\n"
+    "    f2h_dtype dtype;\n"
+    "    ptrdiff_t span;\n"
+    "    f2h_dim dim[" << rank << "];\n"
+    "} " << name << ";\n\n"
+    "/* Describes the column-major array at base with extent[i] elements in\n"
+    "   dimension i, byte_stride[i] bytes apart or contiguous if byte_stride is\n"
+    "   NULL, for passing to an assumed-shape argument without copying. */\n"
+    "static inline " << name << " " << name << "_of(void *base, size_t elem_len, signed char type,\n"
+    "    const ptrdiff_t *extent, const ptrdiff_t *byte_stride)\n"
+    "{\n"
+    "    " << name << " d;\n"
+    "    ptrdiff_t stride = 1;\n"
+    "    int i;\n"
+    "    d.base_addr = base;\n"
+    "    d.offset = 0;\n"
+    "    d.dtype.elem_len = elem_len;\n"
+    "    d.dtype.version = 0;\n"
+    "    d.dtype.rank = " << rank << ";\n"
+    "    d.dtype.type = type;\n"
+    "    d.dtype.attribute = 0;\n"
+    "    d.span = (ptrdiff_t)elem_len;\n"
+    "    for (i = 0; i < " << rank << "; ++i) {\n"
+    "        d.dim[i].stride = byte_stride ? byte_stride[i] / (ptrdiff_t)elem_len : stride;\n"
+    "        d.dim[i].lower_bound = 1;\n"
+    "        d.dim[i].upper_bound = extent[i];\n"
+    "        d.offset -= d.dim[i].stride;\n"
+    "        stride *= extent[i];\n"
+    "    }\n"
+    "    return d;\n"
+    "}\n"
+    "#endif\n\n";
+}
+
+const char *ArrayDescriptor::typeCode(dwarf::TypeKind type, bool derived)
+{
+    if (derived) {
+        return "F2H_TYPE_DERIVED";
+    }
+    switch (type) {
+        case dwarf::DW_ATE_boolean:
+            return "F2H_TYPE_LOGICAL";
+        case dwarf::DW_ATE_float:
+            return "F2H_TYPE_REAL";
+        case dwarf::DW_ATE_complex_float:
+            return "F2H_TYPE_COMPLEX";
+        case dwarf::DW_ATE_signed_char:
+        case dwarf::DW_ATE_unsigned_char:
+            return "F2H_TYPE_CHARACTER";
+        default:
+            return "F2H_TYPE_INTEGER";
+    }
+}
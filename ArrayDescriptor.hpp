@@ -0,0 +1,59 @@
+#ifndef ArrayDescriptor_hpp
+#define ArrayDescriptor_hpp
+
+#include <cstdint>
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "Die.hpp"
+
+namespace llvm {
+class raw_ostream;
+}
+
+/**
+ * The gfortran array descriptor, which assumed-shape, ALLOCATABLE and POINTER
+ * arrays are passed and stored as.
+ *
+ * Their DW_TAG_array_type has a DW_AT_data_location, and DW_AT_allocated or
+ * DW_AT_associated, and bounds that are expressions reading the descriptor
+ * instead of constants.  The header declares such an array as a struct
+ * f2h_array_r<rank> with the layout of gfortran 8 and later:
+ *
+ *     void *base_addr;
+ *     ptrdiff_t offset;
+ *     f2h_dtype dtype;     // elem_len, version, rank, type, attribute
+ *     ptrdiff_t span;
+ *     f2h_dim dim[rank];   // stride, lower_bound, upper_bound
+ *
+ * and f2h_array_r<rank>_of() builds one over memory the caller already has,
+ * so a kernel with assumed-shape arguments can be called without copying.
+ */
+class ArrayDescriptor
+{
+public:
+    /// \return true if the array type at \p arrayType is described by a descriptor.
+    static bool isDescriptor(Die arrayType);
+
+    /**
+     * \return the rank of the descriptor array at \p arrayType.  Throws if the
+     * bounds or strides are not read from where the layout above puts them, as
+     * with the descriptors of gfortran before 8.
+     */
+    static unsigned extractRank(Die arrayType);
+
+    /// \return the size in bytes of a descriptor of \p rank for a target with \p addressSize byte pointers.
+    static uint64_t size(unsigned rank, unsigned addressSize);
+
+    /// Writes the name of the descriptor struct of \p rank.
+    static void writeName(llvm::raw_ostream &os, unsigned rank);
+
+    /// Writes f2h_dim, f2h_dtype and the F2H_TYPE_ codes every descriptor needs.
+    static void writeSupport(llvm::raw_ostream &os);
+
+    /// Writes the descriptor struct of \p rank and the inline function that fills one in.
+    static void writeRank(llvm::raw_ostream &os, unsigned rank);
+
+    /// \return the F2H_TYPE_ code of elements of \p type, or of a derived type if \p derived is set.
+    static const char *typeCode(llvm::dwarf::TypeKind type, bool derived);
+};
+
+#endif
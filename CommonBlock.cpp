@@ -1,4 +1,5 @@
 #include "CommonBlock.hpp"
+#include "Stats.hpp"
 #include "llvm/DebugInfo/DWARF/DWARFCompileUnit.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugAbbrev.h"
@@ -7,6 +8,7 @@
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/BinaryFormat/Dwarf.h"
+#include <algorithm>
 #include <sstream>
 
 using namespace llvm;
@@ -16,39 +18,49 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &o, const CommonBlock &cb)
     o << "common block " << cb.name_ << '\n';
     for (auto &v : cb.vars_)
     {
-        o << "    " << v->cDeclaration();
+        o << "    ";
+        v->cDeclaration(o);
     }
     return o;
 }
 
-CommonBlock::CommonMap CommonBlock::map_;
-
 CommonBlock::Handle
-CommonBlock::extractAndAdd(DWARFDie die)
+CommonBlock::extractAndAdd(Die die, CommonList &commons, ModelArena &arena)
 {
     std::string commonName = die.getName(llvm::DINameKind::ShortName);
-    auto fit = CommonBlock::map_.find(commonName);
-    if (fit == CommonBlock::map_.end()) {
-        CommonBlock::Handle cb(CommonBlock::extract(die));
-        CommonBlock::map_.insert(std::make_pair(commonName, cb));
+    auto fit = commons.find(commonName);
+    if (fit == commons.end()) {
+        CommonBlock::Handle cb(CommonBlock::extract(die, arena));
+        commons.insert(std::make_pair(commonName, cb));
         return cb;
     } else {
         return fit->second;
     }
 }
 
+void CommonBlock::merge(const CommonList &commons, CommonMap &map)
+{
+    Stats::add(Stats::CommonBlocks, commons.size());
+    for (auto &cbit : commons) {
+        // insert does nothing if the name is already present
+        if (!map.insert(cbit).second) {
+            Stats::add(Stats::CommonBlocksDeduplicated);
+        }
+    }
+}
+
 
-CommonBlock::Handle CommonBlock::extract(DWARFDie die)
+CommonBlock::Handle CommonBlock::extract(Die die, ModelArena &arena)
 {
-    CommonBlock::Handle r(new CommonBlock());
+    CommonBlock::Handle r = arena.make<CommonBlock>();
     
     if (die.getTag() != dwarf::DW_TAG_common_block) {
         throw std::runtime_error("DIE is not a common block");
     }
 
     // names
-    r->name_ = die.getName(DINameKind::ShortName);
-    r->linkageName_ = die.getName(DINameKind::LinkageName);
+    r->name_ = arena.intern(die.getName(DINameKind::ShortName));
+    r->linkageName_ = arena.intern(die.getName(DINameKind::LinkageName));
     
 #if 0 ///\todo did something in llvm 3.7
     auto debugInfoData = cu->getDebugInfoExtractor();
@@ -58,64 +70,134 @@ CommonBlock::Handle CommonBlock::extract(DWARFDie die)
 #endif
     
     // children of common are the variables it contains
+    SmallVector<Variable::Handle, 16> vars;
+    bool linked = true;
     auto child = die.getFirstChild();
     while (child.isValid() && !child.isNULL()) {
-        auto var = Variable::extract(Variable::COMMON_BLOCK_MEMBER, child);
+        auto var = Variable::extract(Variable::COMMON_BLOCK_MEMBER, child, arena);
+        // the location is only used for common block members to determine padding
+        linked = var->extractLocation(child) && linked;
         
         // an equivalence statment will cause the same memory to appear twice in the common block
         // under different names.  Throw away the second one for now.
-        if (r->vars_.empty() || (var->location_ != r->vars_.back()->location_)) {
-            r->vars_.push_back(std::move(var));
+        if (vars.empty() || (var->location_ != vars.back()->location_)) {
+            vars.push_back(var);
         }        
         child = child.getSibling();
     }
-    r->insertPadding();
+    
+    // member locations are absolute addresses in a linked file, the layout is relative to the block
+    uint64_t base = vars.empty() ? 0 : vars[0]->location_;
+    r->address_ = linked ? base : 0;
+    for (auto &v : vars) {
+        v->location_ -= base;
+    }
+    insertPadding(vars, arena);
+    r->vars_ = arena.copy<Variable::Handle>(vars);
     
     return r;
 }
 
-void CommonBlock::insertPadding()
+void CommonBlock::insertPadding(SmallVectorImpl<Variable::Handle> &vars, ModelArena &arena, uint64_t size)
 {
-    assert(vars_[0]->location_ == 0);
+    Stats::Timer timer(Stats::Padding);
+    assert(vars[0]->location_ == 0);
     size_t loc = 0, padCount=1;
-    auto it = vars_.begin();
+    auto context = vars[0]->context_;
+    auto makePad = [&](size_t pad) {
+        std::stringstream ss;
+        ss << "pad" << padCount++;
+        Variable::Handle padVar = arena.make<Variable>();
+        padVar->location_ = loc;
+        padVar->elementSize_ = 1;
+        padVar->type_ = dwarf::DW_ATE_unsigned;
+        padVar->name_ = arena.intern(ss.str());
+        padVar->context_ = context;
+        if (pad > 1) {
+            Variable::Dimension dim(std::make_pair(0, pad-1));
+            padVar->dims_ = arena.copy<Variable::Dimension>(dim);
+        }
+        return padVar;
+    };
+    auto it = vars.begin();
     loc += (*it)->elementSize() * (*it)->elementCount();
     ++it;
-    while (it != vars_.end()) {
+    while (it != vars.end()) {
         ptrdiff_t pad = (*it)->location_ - loc;
         assert(pad >= 0);
         if (pad) {
-            std::stringstream ss;
-            ss << "pad" << padCount++;
-            Variable::Handle padVar(new Variable());
-            padVar->location_ = loc;
-            padVar->elementSize_ = 1;
-            padVar->type_ = dwarf::DW_ATE_unsigned;
-            padVar->name_ = ss.str();
-            padVar->context_ = Variable::COMMON_BLOCK_MEMBER;
-            if (pad > 1) {
-                padVar->dims_.push_back(Variable::Dimension(std::make_pair(0, pad-1)));
-            }
-            it = vars_.insert(it, std::move(padVar));
+            it = vars.insert(it, makePad(pad));
             ++it;
             loc += pad;
         }
         loc += (*it)->elementSize() * (*it)->elementCount();
         ++it;
     }
+    if (size > loc) {
+        vars.push_back(makePad(size - loc));
+    }
 }
 
-std::string CommonBlock::cDeclaration() const
+void CommonBlock::cDeclaration(llvm::raw_ostream &os) const
 {
-    std::stringstream ss;
-    ss << "extern struct { \n";
+    os << "extern struct { \n";
     
     for (auto &v : vars_)
     {
-        ss << "    " << v->cDeclaration() << ";" << std::endl;
+        os << "    ";
+        v->cDeclaration(os);
+        os << ";\n";
     }
     
-    ss << "} " << linkageName_ << ";" << std::endl;
+    os << "} " << linkageName_ << ";\n";
+}
+
+void CommonBlock::cxxViews(llvm::raw_ostream &os) const
+{
+    bool any = false;
+    for (auto &v : vars_) {
+        if (v->dims_.empty() || v->isPadding()) {
+            continue;
+        }
+        if (!any) {
+            os << "namespace " << linkageName_ << " {\n";
+            any = true;
+        }
+        os << "using " << v->name_ << "_type = ";
+        v->cxxViewType(os);
+        os << ";\n";
+        os << "inline " << v->name_ << "_type " << v->name_ << "() { return " << v->name_ << "_type("
+           << "reinterpret_cast<" << v->name_ << "_type::pointer>(&::" << linkageName_ << "." << v->name_
+           << ")); }\n";
+    }
+    if (any) {
+        os << "}\n";
+    }
+}
+
+void CommonBlock::numpyDtype(llvm::raw_ostream &os) const
+{
+    SmallVector<Variable::Handle, 16> vars;
+    uint64_t size = 0;
+    for (auto &v : vars_) {
+        size = std::max<uint64_t>(size, v->location_ + v->elementSize() * v->elementCount());
+        if (!v->isPadding()) {
+            vars.push_back(v);
+        }
+    }
     
-    return ss.str();
+    os << linkageName_ << " = np.dtype({\n    'names': [";
+    for (size_t i=0; i<vars.size(); ++i) {
+        os << (i ? ", " : "") << "'" << vars[i]->name_ << "'";
+    }
+    os << "],\n    'formats': [";
+    for (size_t i=0; i<vars.size(); ++i) {
+        os << (i ? ", " : "");
+        vars[i]->numpyFormat(os);
+    }
+    os << "],\n    'offsets': [";
+    for (size_t i=0; i<vars.size(); ++i) {
+        os << (i ? ", " : "") << vars[i]->location_;
+    }
+    os << "],\n    'itemsize': " << size << "})\n";
 }
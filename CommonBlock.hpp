@@ -5,6 +5,9 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <map>
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "Variable.hpp"
 
 namespace llvm {
@@ -16,32 +19,72 @@ class DWARFCompileUnit;
 class CommonBlock
 {
 public:
-    using Handle = std::shared_ptr<CommonBlock>;
+    using Handle = CommonBlock *;
     using CommonMap = std::unordered_map<std::string, Handle>;
+
+    /**
+     * Common blocks in the order they were first encountered.  Each extraction
+     * job fills its own list so jobs can run concurrently, and merging the lists
+     * in input order reproduces the insertion order of a serial run.
+     */
+    using CommonList = llvm::MapVector<std::string, Handle, std::map<std::string, unsigned> >;
     
     /**
      * Extracts the common common block definition from the dwarf data
-     * and stores it in the map.  If the map already contains a common
+     * and stores it in the list.  If the list already contains a common
      * block with the same name, then this method assumes they are
-     * identical and does nothing.
+     * identical and does nothing.  New blocks are allocated in \p arena.
+     */
+    static Handle extractAndAdd(Die die, CommonList &commons, ModelArena &arena);
+
+    /**
+     * Adds the common blocks from \p commons to \p map unless a block with
+     * the same name is already there.  The arenas of the merged lists must
+     * outlive \p map.
      */
-    static Handle extractAndAdd(llvm::DWARFDie die);
+    static void merge(const CommonList &commons, CommonMap &map);
+
+    /// Name of the block's symbol.
+    llvm::StringRef linkageName() const { return linkageName_; }
+
+    /// The members in memory order, padding included.
+    llvm::ArrayRef<Variable::Handle> members() const { return vars_; }
 
-    /// Contains all common blocks added so far and indexed by name.
-    static CommonMap map_;
+    /// Writes the C declaration for this common block to \p os.
+    void cDeclaration(llvm::raw_ostream &os) const;
 
-    /// \return C declaration for this common block.
-    std::string cDeclaration() const;
+    /**
+     * Writes a namespace named after the common block with an accessor
+     * returning a fortran_array over each array member, nothing if there are none.
+     */
+    void cxxViews(llvm::raw_ostream &os) const;
+
+    /**
+     * Writes a Python assignment of the NumPy structured dtype of this block to
+     * its linkage name.  The members keep their offsets, padding is left out.
+     */
+    void numpyDtype(llvm::raw_ostream &os) const;
 
 private:
     friend llvm::raw_ostream &operator<<(llvm::raw_ostream &, const CommonBlock &);
-    static Handle extract(llvm::DWARFDie die);
+    friend class ModelCache;
+    friend class LayoutReport;
+    friend class ModelWriter;
+    friend class DerivedType;
+    static Handle extract(Die die, ModelArena &arena);
+
+    /**
+     * Fills the gaps between \p vars, which are in memory order starting at
+     * 0, with padding members, and the space after the last one up to \p size.
+     */
+    static void insertPadding(llvm::SmallVectorImpl<Variable::Handle> &vars, ModelArena &arena, uint64_t size = 0);
 
-    void insertPadding();
+    llvm::StringRef name_;
+    llvm::StringRef linkageName_;
+    llvm::ArrayRef<Variable::Handle> vars_;
 
-    std::string name_;
-    std::string linkageName_;
-    std::vector<Variable::Handle> vars_;
+    /// Address of the block, 0 if it isn't known as in a relocatable object.
+    uint64_t address_ = 0;
 };
 
 #endif
@@ -0,0 +1,143 @@
+#include "CxxSupport.hpp"
+#include "llvm/Support/raw_ostream.h"
+
+void CxxSupport::writeArrayView(llvm::raw_ostream &os)
+{
+    // Extents known at compile time are template arguments, so the offset
+    // computation folds to constants and inlines completely.  Only C++11 is
+    // assumed of the compiler using the header.
+    os << R"(#ifndef F2H_FORTRAN_ARRAY
+#define F2H_FORTRAN_ARRAY
+#include <cstddef>
+namespace f2h {
+
+/// extent of a dimension that is only known at run time
+constexpr std::ptrdiff_t dynamic_extent = -1;
+
+/// a dimension with subscripts from Lower to Lower + Extent - 1
+template <std::ptrdiff_t Lower, std::ptrdiff_t Extent = dynamic_extent>
+struct dim
+{
+    static constexpr std::ptrdiff_t lower = Lower;
+    static constexpr std::ptrdiff_t extent = Extent;
+};
+
+namespace detail {
+template <typename... Dims> struct layout_left;
+
+template <> struct layout_left<>
+{
+    static std::ptrdiff_t offset(const std::ptrdiff_t *) { return 0; }
+};
+
+template <typename D, typename... Rest> struct layout_left<D, Rest...>
+{
+    template <typename... I>
+    static std::ptrdiff_t offset(const std::ptrdiff_t *extents, std::ptrdiff_t i, I... rest)
+    {
+        return (i - D::lower) + (D::extent != dynamic_extent ? D::extent : extents[0]) *
+            layout_left<Rest...>::offset(extents + 1, rest...);
+    }
+};
+}
+
+/**
+ * Non-owning column-major view of Fortran array data, indexed like the
+ * Fortran array with a(i, j, ...) starting from the lower bounds.  Extents
+ * that are not known at compile time are passed to the constructor in order.
+ * The last one is never needed for indexing and may be left out.
+ */
+template <typename T, typename... Dims>
+class fortran_array
+{
+public:
+    using element_type = T;
+    using pointer = T *;
+    static constexpr std::size_t rank = sizeof...(Dims);
+
+    template <typename... Extents>
+    explicit fortran_array(pointer data, Extents... extents) : data_(data)
+    {
+        const std::ptrdiff_t fixed[] = { Dims::extent... };
+        const std::ptrdiff_t given[] = { std::ptrdiff_t(extents)..., dynamic_extent };
+        std::size_t next = 0;
+        for (std::size_t d = 0; d < rank; ++d) {
+            if (fixed[d] != dynamic_extent) {
+                extents_[d] = fixed[d];
+            } else {
+                extents_[d] = given[next];
+                next += next < sizeof...(Extents);
+            }
+        }
+    }
+
+    template <typename... I>
+    T &operator()(I... i) const
+    {
+        static_assert(sizeof...(I) == rank, "one subscript per dimension");
+        return data_[detail::layout_left<Dims...>::offset(extents_, std::ptrdiff_t(i)...)];
+    }
+
+    pointer data() const { return data_; }
+    std::ptrdiff_t extent(std::size_t d) const { return extents_[d]; }
+
+private:
+    pointer data_;
+    std::ptrdiff_t extents_[rank];
+};
+
+}
+#endif
+)";
+}
+
+void CxxSupport::writeCharArg(llvm::raw_ostream &os)
+{
+    // Only sources whose length is already known convert implicitly, a bare
+    // char pointer would need a strlen on every call.
+    os << R"(#ifndef F2H_CHAR_ARG
+#define F2H_CHAR_ARG
+#include <cstddef>
+#include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+namespace f2h {
+
+/**
+ * A CHARACTER argument: the address of the characters and the length that
+ * is passed after the other arguments.  A string literal loses its
+ * terminator, any other char array is passed whole.  Fortran may assign to
+ * an argument that isn't INTENT(IN), so only pass constant strings to those.
+ */
+struct char_arg
+{
+    char *data;
+    std::size_t size;
+
+    char_arg(const char *data, std::size_t size) : data(const_cast<char *>(data)), size(size) {}
+    char_arg(char &c) : data(&c), size(1) {}
+    template <std::size_t N>
+    char_arg(char (&s)[N]) : data(s), size(N) {}
+    template <std::size_t N>
+    char_arg(const char (&s)[N]) : data(const_cast<char *>(s)), size(N - 1) {}
+    char_arg(const std::string &s) : data(const_cast<char *>(s.data())), size(s.size()) {}
+#if __cplusplus >= 201703L
+    char_arg(std::string_view s) : data(const_cast<char *>(s.data())), size(s.size()) {}
+#endif
+};
+
+}
+#endif
+)";
+}
+
+void CxxSupport::writeResultBuffers(llvm::raw_ostream &os)
+{
+    os << R"(#ifndef F2H_RESULT_BUFFERS
+#define F2H_RESULT_BUFFERS
+#include <cstddef>
+#include <string>
+#endif
+)";
+}
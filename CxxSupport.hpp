@@ -0,0 +1,25 @@
+#ifndef CxxSupport_hpp
+#define CxxSupport_hpp
+
+namespace llvm {
+class raw_ostream;
+}
+
+/**
+ * C++ support code written into the header ahead of the generated C++ wrappers.
+ * Each piece is guarded so several generated headers can be included together.
+ */
+class CxxSupport
+{
+public:
+    /// Writes f2h::fortran_array, the column-major view used by --cxx-views.
+    static void writeArrayView(llvm::raw_ostream &os);
+
+    /// Writes f2h::char_arg, the CHARACTER argument used by --cxx-strings.
+    static void writeCharArg(llvm::raw_ostream &os);
+
+    /// Writes the includes the result buffers of --cxx-results need.
+    static void writeResultBuffers(llvm::raw_ostream &os);
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "DerivedType.hpp"
+#include "CommonBlock.hpp"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
+#include "llvm/Support/LEB128.h"
+#include <algorithm>
+
+using namespace llvm;
+
+/**
+ * DW_AT_data_member_location is a constant offset, or with DWARF 2 a location
+ * expression that adds it to the address of the structure.
+ */
+static uint64_t memberOffset(Die die)
+{
+    auto loc = die.find(dwarf::DW_AT_data_member_location);
+    if (!loc.hasValue()) {
+        // DWARF 4 allows leaving it out for a member at the start of the structure
+        return 0;
+    }
+    auto offset = loc.getValue().getAsUnsignedConstant();
+    if (offset.hasValue()) {
+        return offset.getValue();
+    }
+    auto block = loc.getValue().getAsBlock();
+    if (!block.hasValue() || block.getValue().empty() || block.getValue()[0] != dwarf::DW_OP_plus_uconst) {
+        throw std::runtime_error("DerivedType::extract--member location is not a constant offset");
+    }
+    return decodeULEB128(block.getValue().data() + 1);
+}
+
+DerivedType::Handle DerivedType::extract(Die die, ModelArena &arena)
+{
+    if (die.getTag() != dwarf::DW_TAG_structure_type) {
+        throw std::runtime_error("DIE is not a derived type");
+    }
+
+    auto memoized = static_cast<const DerivedType *>(arena.memoized(die.getDwarfUnit(), die.getOffset(),
+                                                                      ModelArena::DerivedTypes));
+    if (memoized) {
+        if (memoized->failed_) {
+            throw std::runtime_error("DerivedType::extract--could not extract " + memoized->name_.str());
+        }
+        // possibly still being extracted, if this is a member of the type itself
+        return const_cast<Handle>(memoized);
+    }
+
+    Handle r = arena.make<DerivedType>();
+    const char *name = die.getName(DINameKind::ShortName);
+    if (!name) {
+        throw std::runtime_error("DerivedType::extract--derived type without a name");
+    }
+    r->name_ = arena.intern(name);
+    auto size = die.find(dwarf::DW_AT_byte_size);
+    if (!size.hasValue() || !size.getValue().getAsUnsignedConstant().hasValue()) {
+        throw std::runtime_error("DerivedType::extract--no byte size for " + r->name_.str());
+    }
+    r->byteSize_ = size.getValue().getAsUnsignedConstant().getValue();
+    arena.memoize(die.getDwarfUnit(), die.getOffset(), r, ModelArena::DerivedTypes);
+
+    // the member types memoized meanwhile may point to r, so it stays memoized as failed
+    try {
+        SmallVector<Variable::Handle, 16> members;
+        auto child = die.getFirstChild();
+        while (child.isValid() && !child.isNULL()) {
+            if (child.getTag() == dwarf::DW_TAG_member) {
+                auto var = Variable::extract(Variable::STRUCTURE_MEMBER, child, arena);
+                var->location_ = memberOffset(child);
+                var->checkDeclaration();
+                members.push_back(var);
+            }
+            child = child.getSibling();
+        }
+
+        // members are listed in declaration order, the padding needs them in memory order
+        std::stable_sort(members.begin(), members.end(), [](Variable::Handle a, Variable::Handle b) {
+            return a->location_ < b->location_;
+        });
+        if (!members.empty()) {
+            if (members[0]->location_ != 0) {
+                throw std::runtime_error("DerivedType::extract--first member of " + r->name_.str() + " is not at offset 0");
+            }
+            CommonBlock::insertPadding(members, arena, r->byteSize_);
+        }
+        r->members_ = arena.copy<Variable::Handle>(members);
+    } catch (std::runtime_error &) {
+        r->failed_ = true;
+        throw;
+    }
+    return r;
+}
+
+void DerivedType::collect(const Variable &var, TypeList &types, std::set<std::string> &names)
+{
+    Handle type = var.derived_;
+    if (!type) {
+        return;
+    }
+    auto it = types.find(type->cName().str());
+    if (it != types.end() && it->second == type) {
+        return;
+    }
+    SmallVector<Variable::Handle, 4> descriptors;
+    for (auto &m : type->members_) {
+        if (m->descriptorRank_) {
+            descriptors.push_back(m);
+        } else {
+            collect(*m, types, names);
+        }
+    }
+
+    std::string name = type->name_.str();
+    for (unsigned n = 2; ; ++n) {
+        it = types.find(name);
+        if (it == types.end()) {
+            type->cName_ = n == 2 ? type->name_ : StringRef(*names.insert(name).first);
+            types.insert(std::make_pair(name, type));
+            if (n > 2) {
+                errs() << "derived type " << type->name_ << " has several layouts, one is declared as struct "
+                       << name << "\n";
+            }
+            break;
+        }
+        if (it->second->sameLayout(*type)) {
+            type->cName_ = it->second->cName();
+            break;
+        }
+        name = type->name_.str() + "_" + std::to_string(n);
+    }
+
+    for (auto &m : descriptors) {
+        collect(*m, types, names);
+    }
+}
+
+bool DerivedType::sameLayout(const DerivedType &other) const
+{
+    if (byteSize_ != other.byteSize_ || failed_ != other.failed_ || members_.size() != other.members_.size()) {
+        return false;
+    }
+    for (size_t i=0; i<members_.size(); ++i) {
+        const Variable &a = *members_[i];
+        const Variable &b = *other.members_[i];
+        if (a.name_ != b.name_ || a.location_ != b.location_ || a.type_ != b.type_ ||
+            a.elementSize_ != b.elementSize_ || a.descriptorRank_ != b.descriptorRank_ ||
+            a.dims_.size() != b.dims_.size()) {
+            return false;
+        }
+        for (size_t j=0; j<a.dims_.size(); ++j) {
+            if (a.dims_[j].hasValue() != b.dims_[j].hasValue() ||
+                (a.dims_[j].hasValue() && a.dims_[j].getValue() != b.dims_[j].getValue())) {
+                return false;
+            }
+        }
+        // a descriptor only points at its elements, the types of other members were collected first
+        if (!a.descriptorRank_ && (a.derived_ ? a.derived_->cName() : StringRef()) !=
+                                  (b.derived_ ? b.derived_->cName() : StringRef())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DerivedType::cDefinition(llvm::raw_ostream &os) const
+{
+    if (failed_) {
+        throw std::runtime_error("DerivedType::cDefinition--members of " + name_.str() + " could not be extracted");
+    }
+    for (auto &m : members_) {
+        m->checkDeclaration();
+    }
+
+    os << "struct " << cName() << " {\n";
+    for (auto &m : members_) {
+        os << "    ";
+        m->cDeclaration(os);
+        os << ";\n";
+    }
+    os << "};\n";
+}
+
+void DerivedType::numpyDtype(llvm::raw_ostream &os) const
+{
+    SmallVector<Variable::Handle, 16> members;
+    for (auto &m : members_) {
+        if (!m->isPadding()) {
+            members.push_back(m);
+        }
+    }
+
+    os << "np.dtype({'names': [";
+    for (size_t i=0; i<members.size(); ++i) {
+        os << (i ? ", " : "") << "'" << members[i]->name_ << "'";
+    }
+    os << "], 'formats': [";
+    for (size_t i=0; i<members.size(); ++i) {
+        os << (i ? ", " : "");
+        members[i]->numpyFormat(os);
+    }
+    os << "], 'offsets': [";
+    for (size_t i=0; i<members.size(); ++i) {
+        os << (i ? ", " : "") << members[i]->location_;
+    }
+    os << "], 'itemsize': " << byteSize_ << "})";
+}
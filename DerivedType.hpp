@@ -0,0 +1,78 @@
+#ifndef DerivedType_hpp
+#define DerivedType_hpp
+
+#include <map>
+#include <set>
+#include <string>
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "Variable.hpp"
+
+/**
+ * A Fortran derived type, DW_TAG_structure_type, declared as a C struct.
+ *
+ * The members keep the offsets the compiler gave them in DW_AT_data_member_location
+ * and the gaps between them, and after the last one, are filled with padding the
+ * way CommonBlock does it.  So the struct has the layout of the Fortran type
+ * whether or not it is BIND(C) or SEQUENCE.  Types with a member that has no C
+ * equivalent, such as a scalar POINTER component, throw on extraction.
+ *
+ * A type can have an ALLOCATABLE or POINTER array of itself, which is a
+ * descriptor and doesn't need the type to be complete.  So the type is
+ * memoized in the arena before its members are extracted and the member
+ * resolves to the type being extracted.
+ *
+ * Types of different modules or subprograms can have the same name.  Those
+ * with the same layout share a struct, any other gets a number appended to
+ * its struct name, see collect.
+ */
+class DerivedType
+{
+public:
+    using Handle = DerivedType *;
+
+    /**
+     * Derived types by name, each after the types its members use so they
+     * can be defined in order.
+     */
+    using TypeList = llvm::MapVector<std::string, Handle, std::map<std::string, unsigned> >;
+
+    /**
+     * The type and its members are allocated in \p arena.  Each DIE is only
+     * extracted once, a type that failed to extract throws again.
+     */
+    static Handle extract(Die die, ModelArena &arena);
+
+    /**
+     * Adds the derived type of \p var, if it has one, to \p types after the
+     * types it uses, keyed by its struct name.  A type with the name and the
+     * layout of one already there is declared as that one and not added.  If
+     * the layout differs the type is added as <name>_2, <name>_3 and so on,
+     * with the names kept in \p names.  The element types of descriptor
+     * members come after the type, they don't have to be defined before it.
+     */
+    static void collect(const Variable &var, TypeList &types, std::set<std::string> &names);
+
+    /// \return true if the members of \p other have the names, offsets and types of these.
+    bool sameLayout(const DerivedType &other) const;
+
+    /// The name of the C struct, see collect.
+    llvm::StringRef cName() const { return cName_.empty() ? name_ : cName_; }
+
+    /// Writes the C struct definition to \p os, throws before writing anything if a member has no C equivalent.
+    void cDefinition(llvm::raw_ostream &os) const;
+
+    /// Writes the NumPy structured dtype of the type as an expression, padding is left out.
+    void numpyDtype(llvm::raw_ostream &os) const;
+
+    llvm::StringRef name_;
+    uint64_t byteSize_ = 0;
+    /// in memory order, padding included
+    llvm::ArrayRef<Variable::Handle> members_;
+    /// set if extracting the members threw
+    bool failed_ = false;
+    /// set by collect, empty for name_
+    llvm::StringRef cName_;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "Die.hpp"
+#include "Stats.hpp"
+#include "TypeUnits.hpp"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFUnit.h"
+
+using namespace llvm;
+
+namespace {
+
+/// Parses the entry at \p offset and leaves \p offset just past its attributes.
+bool extractEntry(DWARFUnit &unit, DWARFDebugInfoEntry &entry, Die::Offset *offset)
+{
+    Stats::add(Stats::DIEs);
+    return entry.extractFast(unit, offset);
+}
+
+}
+
+Die Die::unitDie(DWARFUnit &unit)
+{
+    // only parses the first entry of the unit
+    return atOffset(unit, unit.getUnitDIE(true).getOffset());
+}
+
+Die Die::atOffset(DWARFUnit &unit, Offset offset)
+{
+    Die r;
+    if (!extractEntry(unit, r.entry_, &offset)) {
+        return Die();
+    }
+    r.unit_ = &unit;
+    r.next_ = offset;
+    return r;
+}
+
+Optional<DWARFFormValue> Die::find(dwarf::Attribute attr) const
+{
+    if (!isValid()) {
+        return None;
+    }
+    return dwarfDie().find(attr);
+}
+
+Optional<DWARFFormValue> Die::find(ArrayRef<dwarf::Attribute> attrs) const
+{
+    for (auto attr : attrs) {
+        auto r = find(attr);
+        if (r.hasValue()) {
+            return r;
+        }
+    }
+    return None;
+}
+
+Optional<DWARFFormValue> Die::findRecursively(ArrayRef<dwarf::Attribute> attrs) const
+{
+    auto r = find(attrs);
+    if (r.hasValue()) {
+        return r;
+    }
+
+    // DWARFDie does the same, but would need the DIE array to follow the references
+    for (auto ref : { dwarf::DW_AT_specification, dwarf::DW_AT_abstract_origin }) {
+        Die die = getAttributeValueAsReferencedDie(ref);
+        if (die.isValid()) {
+            auto r = die.findRecursively(attrs);
+            if (r.hasValue()) {
+                return r;
+            }
+        }
+    }
+    return None;
+}
+
+const char *Die::getName(DINameKind kind) const
+{
+    if (!isValid() || kind == DINameKind::None) {
+        return nullptr;
+    }
+    if (kind == DINameKind::LinkageName) {
+        auto name = dwarf::toString(findRecursively({ dwarf::DW_AT_MIPS_linkage_name, dwarf::DW_AT_linkage_name }), nullptr);
+        if (name) {
+            return name;
+        }
+    }
+    return dwarf::toString(findRecursively(dwarf::DW_AT_name), nullptr);
+}
+
+Die Die::getFirstChild() const
+{
+    if (!isValid() || !hasChildren()) {
+        return Die();
+    }
+    return atOffset(*unit_, next_);
+}
+
+Die Die::getSibling() const
+{
+    if (!isValid() || isNULL()) {
+        return Die();
+    }
+    if (!hasChildren()) {
+        return atOffset(*unit_, next_);
+    }
+
+    // jump straight over the children if the producer told us where they end
+    auto sibling = find(dwarf::DW_AT_sibling);
+    if (sibling.hasValue() && sibling.getValue().getAsReference().hasValue()) {
+        return atOffset(*unit_, sibling.getValue().getAsReference().getValue());
+    }
+
+    // otherwise skip the subtree one entry at a time without decoding any attributes
+    Offset offset = next_;
+    unsigned depth = 1;
+    DWARFDebugInfoEntry entry;
+    while (depth > 0) {
+        if (!extractEntry(*unit_, entry, &offset)) {
+            return Die();
+        }
+        if (!entry.getAbbreviationDeclarationPtr()) {
+            --depth;
+        } else if (entry.hasChildren()) {
+            ++depth;
+        }
+    }
+    return atOffset(*unit_, offset);
+}
+
+Die Die::getAttributeValueAsReferencedDie(dwarf::Attribute attr, const TypeUnits *typeUnits) const
+{
+    auto value = find(attr);
+    if (!value.hasValue()) {
+        return Die();
+    }
+    if (value.getValue().getForm() == dwarf::DW_FORM_ref_sig8) {
+        return typeUnits ? typeUnits->typeDie(value.getValue().getRawUValue()) : Die();
+    }
+    auto ref = value.getValue().getAsReference();
+    if (!ref.hasValue()) {
+        return Die();
+    }
+
+    Offset offset = ref.getValue();
+    if (offset >= unit_->getOffset() && offset < unit_->getNextUnitOffset()) {
+        return atOffset(*unit_, offset);
+    }
+
+    // DW_FORM_ref_addr can point into another compile unit
+    DWARFUnit *other = unit_->getContext().getCompileUnitForOffset(offset);
+    if (!other) {
+        return Die();
+    }
+    return atOffset(*other, offset);
+}
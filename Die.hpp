@@ -0,0 +1,87 @@
+#ifndef Die_hpp
+#define Die_hpp
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/DebugInfo/DIContext.h>
+#include <llvm/DebugInfo/DWARF/DWARFDebugInfoEntry.h>
+#include <llvm/DebugInfo/DWARF/DWARFDie.h>
+#include <llvm/DebugInfo/DWARF/DWARFFormValue.h>
+
+namespace llvm {
+class DWARFUnit;
+}
+
+class TypeUnits;
+
+/**
+ * A debugging information entry read straight out of .debug_info.
+ *
+ * llvm::DWARFDie needs the unit to parse every DIE it contains into an array
+ * before the tree can be navigated, so the cost of walking a unit scales with
+ * its total DIE count.  A Die parses one entry at a time instead.  Moving to a
+ * sibling skips the subtree in between, using DW_AT_sibling when the producer
+ * emitted it and otherwise just the abbreviation codes and attribute sizes, so
+ * lexical blocks, inlined bodies and the locals of huge routines are never decoded.
+ * Only the DIEs that are actually looked at cost anything.
+ *
+ * The interface mirrors the parts of llvm::DWARFDie used by f2h.
+ */
+class Die
+{
+public:
+    /// DIE offsets within .debug_info
+    using Offset = uint32_t;
+
+    Die() : unit_(nullptr), next_(0) {}
+
+    /// \return the unit DIE of \p unit, without reading any of its children.
+    static Die unitDie(llvm::DWARFUnit &unit);
+
+    /// \return the DIE that starts at \p offset in \p unit, invalid if there is none.
+    static Die atOffset(llvm::DWARFUnit &unit, Offset offset);
+
+    bool isValid() const { return unit_ != nullptr; }
+    explicit operator bool() const { return isValid(); }
+
+    /// \return true for the null entry that terminates a list of siblings.
+    bool isNULL() const { return entry_.getAbbreviationDeclarationPtr() == nullptr; }
+
+    Offset getOffset() const { return entry_.getOffset(); }
+    llvm::dwarf::Tag getTag() const { return entry_.getTag(); }
+    bool isSubprogramDIE() const { return getTag() == llvm::dwarf::DW_TAG_subprogram; }
+    bool hasChildren() const { return entry_.hasChildren(); }
+    llvm::DWARFUnit *getDwarfUnit() const { return unit_; }
+
+    llvm::Optional<llvm::DWARFFormValue> find(llvm::dwarf::Attribute attr) const;
+
+    /// \return the value of the first of \p attrs that is present.
+    llvm::Optional<llvm::DWARFFormValue> find(llvm::ArrayRef<llvm::dwarf::Attribute> attrs) const;
+
+    /// Looks for the first of \p attrs here, then in the DIEs named by
+    /// DW_AT_specification and DW_AT_abstract_origin.
+    llvm::Optional<llvm::DWARFFormValue> findRecursively(llvm::ArrayRef<llvm::dwarf::Attribute> attrs) const;
+
+    const char *getName(llvm::DINameKind kind) const;
+
+    Die getFirstChild() const;
+    Die getSibling() const;
+
+    /**
+     * Follows a reference within the unit, to another unit or, with
+     * DW_FORM_ref_sig8, to the type unit in \p typeUnits with the signature.
+     */
+    Die getAttributeValueAsReferencedDie(llvm::dwarf::Attribute attr, const TypeUnits *typeUnits = nullptr) const;
+
+private:
+    llvm::DWARFDie dwarfDie() const { return llvm::DWARFDie(unit_, &entry_); }
+
+    llvm::DWARFUnit *unit_;
+    llvm::DWARFDebugInfoEntry entry_;
+
+    /// offset just past this entry's attributes, where its first child starts
+    Offset next_;
+};
+
+#endif
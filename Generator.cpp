@@ -0,0 +1,1197 @@
+#include "Generator.hpp"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFDebugAranges.h"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/BinaryFormat/Magic.h"
+#include "llvm/Object/Archive.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include "AcceleratorIndex.hpp"
+#include "ArrayDescriptor.hpp"
+#include "CxxSupport.hpp"
+#include "MappedFile.hpp"
+#include "ModelCache.hpp"
+#include "ModelReader.hpp"
+#include "ModelWriter.hpp"
+#include "Stats.hpp"
+#include "TimeTrace.hpp"
+#include "TypeUnits.hpp"
+
+using namespace llvm;
+using namespace object;
+
+/**
+ * An object file and the DWARF context built from it.  Shared by the jobs
+ * for its compile units and released when the last of them finishes.
+ * The last job to finish also stores the model in the cache.
+ * Archive members share the mapping of the archive they came from.
+ */
+struct LoadedObject
+{
+    std::shared_ptr<MappedFile> file;
+    std::shared_ptr<Archive> archive;
+    MemoryBufferRef buffer;
+    std::unique_ptr<ObjectFile> object;
+    std::unique_ptr<DWARFContextInMemory> context;
+    /// null if the units are split units, which are not indexed
+    std::unique_ptr<AcceleratorIndex> index;
+    /// subprograms chosen by the selector, if there is one
+    SymbolSelector::Selection symbols;
+    std::string cacheKey;
+    std::atomic<size_t> pendingUnits;
+    /// trace of the input this came from, null without --time-trace
+    TimeTrace *trace = nullptr;
+    /// null if the object has no type units
+    std::unique_ptr<TypeUnits> typeUnits;
+};
+
+Generator::Generator(const Options &options) : options_(options), failed_(false)
+{
+    if (!options_.symbols.empty() || options_.exportedOnly) {
+        selector_.reset(new SymbolSelector(options_.symbols, options_.exportedOnly));
+    }
+    if (!options_.cacheDirectory.empty()) {
+        cache_.reset(new ModelCache(options_.cacheDirectory));
+    }
+    unsigned nthreads = options_.jobs ? options_.jobs : std::thread::hardware_concurrency();
+    if (nthreads > 1) {
+        pool_.reset(new ThreadPool(nthreads));
+    }
+}
+
+Generator::~Generator()
+{
+}
+
+size_t Generator::addFile(const std::string &filename)
+{
+    inputs_.push_back(Input());
+    inputs_.back().name = filename;
+    return inputs_.size() - 1;
+}
+
+size_t Generator::addBuffer(MemoryBufferRef buffer, const std::string &name)
+{
+    inputs_.push_back(Input());
+    inputs_.back().name = name;
+    inputs_.back().buffer = buffer;
+    return inputs_.size() - 1;
+}
+
+bool Generator::error(StringRef filename, std::error_code ec)
+{
+    if (!ec) {
+        return false;
+    }
+    errs() << filename << ": " << ec.message() << "\n";
+    failed_ = true;
+    return true;
+}
+
+/// Runs \p task on the thread pool, or immediately if running serially.
+template <typename Task>
+void Generator::dispatch(Task task)
+{
+    if (pool_) {
+        pool_->async(task);
+    } else {
+        task();
+    }
+}
+
+/**
+ * Maps \p filename into memory.
+ * \return null after reporting the error if that fails.
+ */
+std::shared_ptr<MappedFile> Generator::openFile(const std::string &filename)
+{
+    Stats::Timer timer(Stats::Load, filename);
+    auto FileOrErr = MappedFile::open(filename);
+    if (error(filename, FileOrErr.getError())) {
+        errs() << "failed to open " << filename << '\n';
+        return nullptr;
+    }
+    return std::move(FileOrErr.get());
+}
+
+/**
+ * Maps the object file \p filename into memory.
+ * \return null after reporting the error if that fails.
+ */
+std::shared_ptr<LoadedObject> Generator::openObject(const std::string &filename)
+{
+    std::shared_ptr<LoadedObject> loaded(new LoadedObject());
+    loaded->file = openFile(filename);
+    if (!loaded->file) {
+        return nullptr;
+    }
+    loaded->buffer = loaded->file->buffer();
+    return loaded;
+}
+
+/**
+ * Creates the object file for an opened file.
+ * \return false after reporting the error if that fails.
+ */
+bool Generator::loadObjectFile(const std::string &filename, LoadedObject &loaded)
+{
+    auto ObjOrErr = ObjectFile::createObjectFile(loaded.buffer);
+    if (error(filename, errorToErrorCode(ObjOrErr.takeError()))) {
+        errs() << "failed to create object file " << filename << '\n';
+        return false;
+    }
+    loaded.object = std::move(ObjOrErr.get());
+    return true;
+}
+
+/**
+ * Creates the object file, unless that was done already, and DWARF context
+ * for an opened file.
+ * \return false after reporting the error if that fails.
+ */
+bool Generator::loadDebugInfo(const std::string &filename, LoadedObject &loaded)
+{
+    if (!loaded.object && !loadObjectFile(filename, loaded)) {
+        return false;
+    }
+    loaded.context.reset(new DWARFContextInMemory(*loaded.object));
+    return true;
+}
+
+/**
+ * \return the id that pairs a skeleton unit with its split unit, from
+ * DW_AT_GNU_dwo_id or, with DWARF 5, the unit header.
+ */
+static Optional<uint64_t> dwoId(const DWARFUnit &unit, Die unitDie)
+{
+    if (unit.getVersion() < 5) {
+        return dwarf::toUnsigned(unitDie.find(dwarf::DW_AT_GNU_dwo_id));
+    }
+    if (unit.getUnitType() != dwarf::DW_UT_skeleton && unit.getUnitType() != dwarf::DW_UT_split_compile) {
+        return None;
+    }
+    // unit_length, version, unit_type, address_size, debug_abbrev_offset, dwo_id
+    auto data = unit.getDebugInfoExtractor();
+    uint32_t offset = unit.getOffset();
+    bool dwarf64 = data.getU32(&offset) == 0xffffffff;
+    offset = unit.getOffset() + (dwarf64 ? 24 : 12);
+    return data.getU64(&offset);
+}
+
+/// Indexes the type units of \p loaded, the split ones if \p dwo is set.
+void Generator::setTypeUnits(LoadedObject &loaded, bool dwo)
+{
+    std::unique_ptr<TypeUnits> typeUnits(new TypeUnits(*loaded.context, dwo, typeSignatures_));
+    if (!typeUnits->empty()) {
+        loaded.typeUnits = std::move(typeUnits);
+    }
+}
+
+/**
+ * With split DWARF the unit in the object is a skeleton that names the .dwo
+ * file holding the real debug info.  Maps the .dwo, finds the matching unit
+ * and extracts that instead.
+ */
+void Generator::extractSplitUnit(Die skeleton, StringRef dwoName, const SymbolSelector::Selection *symbols,
+                                 UnitModel &result)
+{
+    SmallString<128> path;
+    if (sys::path::is_relative(dwoName)) {
+        path = dwarf::toString(skeleton.find(dwarf::DW_AT_comp_dir), "");
+    }
+    sys::path::append(path, dwoName);
+    std::string dwoPath = path.str().str();
+
+    // the cache key only covers the object with the skeleton
+    result.cacheable = false;
+
+    std::shared_ptr<LoadedObject> dwo = openObject(dwoPath);
+    if (!dwo || !loadDebugInfo(dwoPath, *dwo)) {
+        return;
+    }
+    if (!options_.copyNames) {
+        result.arena->retain(dwo->file, dwo->buffer.getBuffer());
+    }
+
+    // a .dwo can hold several units, pick the one with the skeleton's id
+    auto id = dwoId(*skeleton.getDwarfUnit(), skeleton);
+    for (auto &cu : dwo->context->dwo_compile_units()) {
+        if (TypeUnits::isTypeUnit(*cu)) {
+            continue;
+        }
+        Die cudie = Die::unitDie(*cu);
+        if (!id || dwoId(*cu, cudie) == id) {
+            setTypeUnits(*dwo, true);
+            const TypeUnits *previous = result.arena->typeUnits();
+            result.arena->useTypeUnits(dwo->typeUnits.get());
+            extractUnit(*cu, nullptr, nullptr, symbols, result);
+            result.arena->useTypeUnits(previous);
+            return;
+        }
+    }
+    // the declarations of the unit are missing like those of a .dwo that can't be read
+    errs() << "no unit in " << dwoPath << " matches the skeleton unit, skipping\n";
+    failed_ = true;
+}
+
+/**
+ * Adds the subprogram at \p die and its common blocks to \p result, unless
+ * \p symbols is given and does not have its linkage name.
+ */
+static void extractSubprogram(Die die, const SymbolSelector::Selection *symbols, UnitModel &result)
+{
+    if (symbols) {
+        const char *linkageName = die.getName(DINameKind::LinkageName);
+        if (!linkageName || !symbols->count(linkageName)) {
+            return;
+        }
+    }
+
+    try {
+        Subprogram::Handle sub = Subprogram::extract(die, result.commons, *result.arena);
+        // empty return w/o error means not a callable subprogram so just ignore
+        if (sub) {
+            result.subprograms.push_back(std::move(sub));
+        }
+    } catch (std::runtime_error &ex) {
+        // skip the subroutine if something goes wrong with the extraction
+        // err message printed at site of throw
+        Stats::add(Stats::SubprogramsSkipped);
+    }
+}
+
+/**
+ * Adds the variables of the module at \p die to \p result.  They are declared
+ * under their linkage name, which is mangled as in __mymod_MOD_state unless
+ * they are BIND(C).
+ */
+static void extractModule(Die die, UnitModel &result)
+{
+    auto child = die.getFirstChild();
+    while (child && !child.isNULL()) {
+        auto linkageName = dwarf::toString(child.find({ dwarf::DW_AT_linkage_name, dwarf::DW_AT_MIPS_linkage_name }));
+        // PARAMETER constants have no symbol, variables of used modules are only declared and
+        // the vtables and default initializers of derived types are artificial
+        if (child.getTag() == dwarf::DW_TAG_variable && linkageName && !child.find(dwarf::DW_AT_declaration) &&
+            !child.find(dwarf::DW_AT_artificial)) {
+            try {
+                Variable::Handle var = Variable::extract(Variable::MODULE_VARIABLE, child, *result.arena);
+                var->name_ = result.arena->intern(linkageName.getValue());
+                result.moduleVariables.push_back(var);
+            } catch (std::runtime_error &ex) {
+                errs() << "skipping module variable " << linkageName.getValue() << ": " << ex.what() << "\n";
+                Stats::add(Stats::ModuleVariablesSkipped);
+            }
+        }
+        child = child.getSibling();
+    }
+}
+
+/**
+ * Traverse the graph looking for common blocks and subprograms.
+ * Immediate children of the compile uniit will be subprograms.
+ * Immediate children of the subprograms will be the common blocks.
+
+ http://llvm.org/doxygen/classllvm_1_1DWARFDebugInfoEntryMinimal.html
+ http://www.dwarfstd.org/doc/DWARF4.pdf
+
+ If the object has a name index then \p subprograms and \p modules hold the
+ offsets of the subprograms and modules and only those DIEs are read.  With
+ --symbols or --exported-only only the subprograms in \p symbols are
+ extracted, and no module variables.
+ */
+void Generator::extractUnit(DWARFUnit &cu, const std::vector<Die::Offset> *subprograms,
+                            const std::vector<Die::Offset> *modules, const SymbolSelector::Selection *symbols,
+                            UnitModel &result)
+{
+    // DIEs are read one at a time as they are visited, so the subtrees of anything
+    // other than subprograms are skipped without being parsed.
+    Die cudie = Die::unitDie(cu);
+
+    auto dwoName = dwarf::toString(cudie.find({ dwarf::DW_AT_GNU_dwo_name, dwarf::DW_AT_dwo_name }));
+    if (dwoName) {
+        extractSplitUnit(cudie, dwoName.getValue(), symbols, result);
+        return;
+    }
+    
+    // ensure compilation unit is fortran
+    auto lang = dwarf::toUnsigned(cudie.find(dwarf::DW_AT_language)).getValueOr(0);
+    if (!(lang == dwarf::DW_LANG_Fortran77 ||
+          lang == dwarf::DW_LANG_Fortran90 ||
+          lang == dwarf::DW_LANG_Fortran95 ||
+          lang == dwarf::DW_LANG_Fortran03 ||
+          lang == dwarf::DW_LANG_Fortran08)) {
+        errs() << cudie.getName(DINameKind::ShortName) << " is not FORTRAN 77, 90, 95, 2003 or 2008.  Skipping\n";
+        return;
+    }
+    
+    result.isFortran = true;
+    result.name = cudie.getName(DINameKind::ShortName);
+    
+    if (subprograms) {
+        Stats::add(Stats::IndexedUnits);
+        for (Die::Offset offset : *subprograms) {
+            extractSubprogram(Die::atOffset(cu, offset), symbols, result);
+        }
+        if (modules && !symbols) {
+            for (Die::Offset offset : *modules) {
+                extractModule(Die::atOffset(cu, offset), result);
+            }
+        }
+        return;
+    }
+
+    // look for children of the compile unit that are subprograms
+    // immediate children of the subprogram include parameters, common blocks, and local variables
+    auto die = cudie.getFirstChild();
+    while (die && !die.isNULL()) {
+        if (die.isSubprogramDIE()) {
+            extractSubprogram(die, symbols, result);
+        } else if (die.getTag() == dwarf::DW_TAG_module && !symbols) {
+            extractModule(die, result);
+        }
+        die = die.getSibling();
+    }
+}
+
+/// \return false if a unit of \p model can't be cached, see UnitModel::cacheable.
+static bool cacheable(const ObjectModel &model)
+{
+    for (auto &unit : model.units) {
+        if (!unit.cacheable) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Drops the units that don't contain any of the selected symbols of \p loaded.
+ * The units are found through .debug_aranges, which only holds final addresses
+ * in linked files, so all the units of a relocatable object are kept.  They
+ * are also all kept if one of the addresses is not covered.
+ */
+static void selectUnits(const LoadedObject &loaded, std::vector<DWARFUnit *> &units)
+{
+    if (loaded.object->isRelocatableObject()) {
+        return;
+    }
+
+    const DWARFDebugAranges *aranges = loaded.context->getDebugAranges();
+    std::set<uint64_t> wanted;
+    for (auto &symbol : loaded.symbols) {
+        auto offset = aranges->findAddress(symbol.second);
+        if (offset == ~decltype(offset)(0)) {
+            return;
+        }
+        wanted.insert(offset);
+    }
+
+    auto unwanted = [&wanted](DWARFUnit *cu) { return wanted.count(cu->getOffset()) == 0; };
+    auto end = std::remove_if(units.begin(), units.end(), unwanted);
+    Stats::add(Stats::SkippedUnits, units.end() - end);
+    units.erase(end, units.end());
+}
+
+/**
+ * Queues a job for each of the compile units in an opened object file.
+ * The jobs share the loaded object, which is released when the last one is done.
+ * If the cache has a model for the object's contents then no jobs are queued.
+ */
+void Generator::extractObject(std::shared_ptr<LoadedObject> loaded, const std::string &filename,
+                              ObjectModel &result)
+{
+    Stats::add(Stats::ObjectFiles);
+    if (cache_) {
+        Stats::Timer timer(Stats::Cache, filename);
+        // a scan may find subprograms the name index leaves out
+        std::string variant = selector_ ? selector_->fingerprint() : "";
+        if (options_.nameIndex) {
+            variant += "\nname-index";
+        }
+        loaded->cacheKey = ModelCache::key(loaded->buffer, variant);
+        if (cache_->load(loaded->cacheKey, result)) {
+            Stats::add(Stats::CachedObjects);
+            return;
+        }
+    }
+
+    std::vector<DWARFUnit *> units;
+    {
+        Stats::Timer timer(Stats::Context, filename);
+
+        // the symbol table decides whether the debug info is needed at all
+        if (selector_) {
+            if (!loadObjectFile(filename, *loaded)) {
+                return;
+            }
+            loaded->symbols = selector_->select(*loaded->object);
+            if (loaded->symbols.empty()) {
+                Stats::add(Stats::SkippedObjects);
+                if (cache_) {
+                    cache_->store(loaded->cacheKey, result);
+                }
+                return;
+            }
+        }
+
+        if (!loadDebugInfo(filename, *loaded)) {
+            return;
+        }
+
+        // a .dwo file given directly only has split units
+        bool dwo = false;
+        for (auto &cu : loaded->context->compile_units()) {
+            if (!TypeUnits::isTypeUnit(*cu)) {
+                units.push_back(cu.get());
+            }
+        }
+        if (!units.empty()) {
+            if (options_.nameIndex) {
+                loaded->index.reset(new AcceleratorIndex(*loaded->context));
+            }
+        } else {
+            dwo = true;
+            for (auto &cu : loaded->context->dwo_compile_units()) {
+                if (!TypeUnits::isTypeUnit(*cu)) {
+                    units.push_back(cu.get());
+                }
+            }
+        }
+        setTypeUnits(*loaded, dwo);
+
+        if (selector_) {
+            selectUnits(*loaded, units);
+        }
+
+        // With DWARF 5 the unit DIE has the bases of .debug_str_offsets,
+        // .debug_addr and .debug_rnglists.  References between units need
+        // them, so they are all read before the jobs run.
+        for (auto pcu : units) {
+            pcu->getUnitDIE(true);
+        }
+    }
+    Stats::add(Stats::CompileUnits, units.size());
+
+    // size the results before queueing any jobs, they hold references into it
+    result.units.resize(units.size());
+    loaded->pendingUnits = result.units.size();
+    if (result.units.empty() && cache_) {
+        cache_->store(loaded->cacheKey, result);
+    }
+
+    for (size_t i=0; i<units.size(); ++i) {
+        DWARFUnit *pcu = units[i];
+        UnitModel *unit = &result.units[i];
+        ObjectModel *object = &result;
+        // names in the model point into the input where they can
+        if (!options_.copyNames) {
+            unit->arena->retain(loaded->file, loaded->buffer.getBuffer());
+            if (loaded->archive) {
+                unit->arena->retain(loaded->archive, loaded->buffer.getBuffer());
+            }
+        }
+        std::string name = filename;
+        dispatch([this, loaded, pcu, unit, object, name]() {
+            TimeTrace::Bind bind(loaded->trace);
+            {
+                Stats::Timer timer(Stats::Unit, name);
+                // the type units go away with the object, the arena stays with the model
+                unit->arena->useTypeUnits(loaded->typeUnits.get());
+                extractUnit(*pcu, loaded->index ? loaded->index->subprograms(*pcu) : nullptr,
+                            loaded->index ? loaded->index->modules(*pcu) : nullptr,
+                            selector_ ? &loaded->symbols : nullptr, *unit);
+                unit->arena->useTypeUnits(nullptr);
+            }
+            if (--loaded->pendingUnits == 0 && cache_ && cacheable(*object)) {
+                cache_->store(loaded->cacheKey, *object);
+            }
+        });
+    }
+}
+
+/**
+ * Queues a job for each member of an archive.  Members are read in place from
+ * \p buffer, the mapped archive unless it was added as a buffer, nothing is
+ * extracted to disk.
+ */
+void Generator::extractArchive(std::shared_ptr<MappedFile> file, MemoryBufferRef buffer,
+                               const std::string &filename, std::vector<ObjectModel> &results)
+{
+    auto ArchiveOrErr = Archive::create(buffer);
+    if (error(filename, errorToErrorCode(ArchiveOrErr.takeError()))) {
+        errs() << "failed to read archive " << filename << '\n';
+        return;
+    }
+    // thin archive members are loaded into buffers owned by the archive
+    std::shared_ptr<Archive> archive(std::move(ArchiveOrErr.get()));
+
+    std::vector<std::pair<std::string, MemoryBufferRef> > members;
+    Error Err = Error::success();
+    for (auto &child : archive->children(Err)) {
+        auto NameOrErr = child.getName();
+        if (error(filename, errorToErrorCode(NameOrErr.takeError()))) {
+            errs() << "failed to read member name in archive " << filename << '\n';
+            continue;
+        }
+        auto BuffOrErr = child.getMemoryBufferRef();
+        if (error(filename, errorToErrorCode(BuffOrErr.takeError()))) {
+            errs() << "failed to read member " << NameOrErr.get() << " of archive " << filename << '\n';
+            continue;
+        }
+        members.push_back(std::make_pair(filename + "(" + NameOrErr.get().str() + ")", BuffOrErr.get()));
+    }
+    if (error(filename, errorToErrorCode(std::move(Err)))) {
+        errs() << "failed to read archive " << filename << '\n';
+    }
+
+    // size the results before queueing any jobs, they hold references into it
+    results.resize(members.size());
+    for (size_t i=0; i<members.size(); ++i) {
+        std::shared_ptr<LoadedObject> loaded(new LoadedObject());
+        loaded->file = file;
+        loaded->archive = archive;
+        loaded->buffer = members[i].second;
+        loaded->trace = TimeTrace::current();
+        std::string name = members[i].first;
+        ObjectModel *result = &results[i];
+        dispatch([this, loaded, name, result]() {
+            TimeTrace::Bind bind(loaded->trace);
+            extractObject(loaded, name, *result);
+        });
+    }
+}
+
+/**
+ * Opens \p input, unless it was added as a buffer, and queues the jobs to
+ * extract it.  Its models are one for an object file or one per member for an archive.
+ */
+void Generator::extractInput(Input &input)
+{
+    Stats::add(Stats::InputFiles);
+    std::shared_ptr<MappedFile> file;
+    MemoryBufferRef buffer = input.buffer;
+    if (!buffer.getBufferStart()) {
+        file = openFile(input.name);
+        if (!file) {
+            return;
+        }
+        buffer = file->buffer();
+    }
+
+    if (identify_magic(buffer.getBuffer()) == file_magic::archive) {
+        extractArchive(file, buffer, input.name, input.models);
+        return;
+    }
+
+    std::shared_ptr<LoadedObject> loaded(new LoadedObject());
+    loaded->file = file;
+    loaded->buffer = buffer;
+    loaded->trace = TimeTrace::current();
+    input.models.resize(1);
+    extractObject(loaded, input.name, input.models[0]);
+}
+
+void Generator::extract(const std::vector<TimeTrace *> &traces)
+{
+    std::vector<size_t> all(inputs_.size());
+    for (size_t i=0; i<all.size(); ++i) {
+        all[i] = i;
+    }
+    extract(all, traces);
+}
+
+/**
+ * Each input is a job that queues a job per archive member or compile unit.
+ * The pool waits for all of them, the models are merged in input order by writeHeader.
+ */
+void Generator::extract(const std::vector<size_t> &inputs, const std::vector<TimeTrace *> &traces)
+{
+    // the declared subprograms and merged common blocks point into the models about to be replaced
+    failed_ = false;
+    declared_.clear();
+    stringOverloads_.clear();
+    resultOverloads_.clear();
+    commons_.clear();
+    types_.clear();
+    descriptorRanks_.clear();
+    moduleVariables_.clear();
+    for (size_t i : inputs) {
+        Input *input = &inputs_[i];
+        input->models.clear();
+        TimeTrace *trace = i < traces.size() ? traces[i] : nullptr;
+        dispatch([this, input, trace]() {
+            TimeTrace::Bind bind(trace);
+            extractInput(*input);
+        });
+    }
+    if (pool_) {
+        pool_->wait();
+    }
+}
+
+void Generator::writeModel(raw_ostream &os, bool json) const
+{
+    ModelWriter writer;
+    for (auto sub : declared_) {
+        writer.add(*sub);
+    }
+    for (auto &cbit : commons_) {
+        writer.add(*cbit.second);
+    }
+    // the types and variables that the header declares
+    for (auto &tit : types_) {
+        if (!tit.second->failed_) {
+            writer.add(*tit.second);
+        }
+    }
+    std::set<StringRef> names;
+    for (auto v : moduleVariables_) {
+        try {
+            v->checkDeclaration();
+        } catch (std::runtime_error &) {
+            continue;
+        }
+        if (names.insert(v->name_).second) {
+            writer.addModuleVariable(*v);
+        }
+    }
+    if (!json) {
+        writer.write(os);
+        return;
+    }
+
+    // the JSON is written from the binary model so it shows exactly what a reader sees
+    std::string binary;
+    raw_string_ostream bs(binary);
+    writer.write(bs);
+    bs.flush();
+    std::vector<uint64_t> aligned((binary.size() + 7) / 8);
+    std::memcpy(aligned.data(), binary.data(), binary.size());
+    std::ostringstream js;
+    ModelReader(reinterpret_cast<const char *>(aligned.data()), binary.size()).writeJSON(js);
+    os << js.str();
+}
+
+/**
+ * The module has a NumPy dtype per common block and a class that views a
+ * block in place through ctypes.
+ */
+void Generator::writePythonModule(raw_ostream &os) const
+{
+    os << R"(# automatically generated by f2h
+"""NumPy views of FORTRAN common blocks.
+
+Each common block has a structured dtype named after its linkage name, with
+the members at their offsets.  Arrays are subarrays with the dimensions
+reversed, so they have the memory layout of the FORTRAN array.  CommonBlock
+views a block of a loaded library in place, for example
+
+    lib = ctypes.CDLL('libfoo.so', ctypes.RTLD_GLOBAL)
+    blk = CommonBlock(lib, 'blk_')
+    blk.mc[0, 2] = 1.0  # MC(1, 3)
+"""
+import ctypes
+import numpy as np
+
+)";
+    std::vector<CommonBlock::Handle> blocks;
+    for (auto &cbit : commons_) {
+        blocks.push_back(cbit.second);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](CommonBlock::Handle a, CommonBlock::Handle b) {
+        return a->linkageName() < b->linkageName();
+    });
+    std::vector<StringRef> names;
+    for (auto cb : blocks) {
+        // a block is written whole or not at all
+        try {
+            std::string dtype;
+            raw_string_ostream ds(dtype);
+            cb->numpyDtype(ds);
+            os << ds.str() << '\n';
+            names.push_back(cb->linkageName());
+        } catch (std::exception &ex) {
+            errs() << "skipping common block " << cb->linkageName() << " in the python module: " << ex.what() << '\n';
+        }
+    }
+    os << "dtypes = {\n";
+    for (auto &name : names) {
+        os << "    '" << name << "': " << name << ",\n";
+    }
+    os << R"(}
+
+
+class CommonBlock(object):
+    """Live view of the common block symbol in lib, a ctypes.CDLL.
+
+    Members are attributes.  Arrays are writable views transposed to be
+    indexed in FORTRAN order, from 0 rather than the FORTRAN lower bounds.
+    Assigning to a scalar member writes it to the block.
+    """
+
+    def __init__(self, lib, name):
+        dtype = dtypes[name]
+        memory = (ctypes.c_char * dtype.itemsize).in_dll(lib, name)
+        object.__setattr__(self, '_memory', memory)
+        object.__setattr__(self, '_array', np.frombuffer(memory, dtype))
+
+    def __getattr__(self, member):
+        if member not in self._array.dtype.names:
+            raise AttributeError(member)
+        value = self._array[member][0]
+        return value.T if isinstance(value, np.ndarray) else value
+
+    def __setattr__(self, member, value):
+        if member not in self._array.dtype.names:
+            raise AttributeError(member)
+        self._array[member][0] = value
+
+    def __dir__(self):
+        return list(self._array.dtype.names)
+
+
+def bind(lib):
+    """Returns a CommonBlock for each of the dtypes defined in lib."""
+    blocks = {}
+    for name in dtypes:
+        try:
+            blocks[name] = CommonBlock(lib, name)
+        except ValueError:
+            pass
+    return blocks
+)";
+}
+
+/**
+ * Writes the declarations for the subprograms in \p unit.  The subprograms
+ * that were declared are added to \p declared.
+ */
+void Generator::emitUnit(const UnitModel &unit, raw_ostream &out, std::vector<Subprogram::Handle> &declared)
+{
+    // with a symbol selection most units have nothing to declare
+    if (!unit.isFortran || (selector_ && unit.subprograms.empty())) {
+        return;
+    }
+
+    out << "// compilation unit: " << unit.name << '\n';
+    for (auto &sub : unit.subprograms) {
+        try {
+            sub->cDeclaration(out, options_.arrayExtents);
+            out << '\n';
+            Stats::add(Stats::Subprograms);
+            if (!sub->unsupported_) {
+                declared.push_back(sub);
+            }
+        } catch (std::runtime_error &ex) {
+            // skip the subroutine if something goes wrong with the declaration
+            // err message printed at site of throw
+            Stats::add(Stats::SubprogramsSkipped);
+        }
+    }
+    out << '\n';
+}
+
+namespace {
+
+/// \return \p s with everything but letters and digits replaced by underscores.
+std::string identifier(StringRef s)
+{
+    std::string r;
+    for (char c : s) {
+        r.push_back(isalnum(static_cast<unsigned char>(c)) ? c : '_');
+    }
+    return r;
+}
+
+/// Starts a header named \p name, guarded by a macro made from it.
+void openSplitHeader(raw_ostream &out, StringRef name)
+{
+    std::string guard = StringRef(identifier(name)).upper();
+    out << "// automatically generated by f2h\n\n"
+    "#ifndef F2H_" << guard << "\n"
+    "#define F2H_" << guard << "\n\n";
+}
+
+const char *externC = "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
+const char *endExternC = "#ifdef __cplusplus\n}\n#endif\n";
+
+}
+
+/// Writes the includes, typedefs and macros the declarations need.
+void Generator::writePrelude(raw_ostream &out) const
+{
+    // kludge c99 complex compatibility with c++
+    out << "#include <stdint.h>\n\n"
+    "#ifdef __cplusplus\n"
+    "#include <complex>\n"
+    "using float_complex = std::complex<float>;\n"
+    "using double_complex = std::complex<double>;\n"
+    "using long_double_complex = std::complex<long double>;\n"
+    "#else\n"
+    "#include <complex.h>\n"
+    "typedef float complex float_complex;\n"
+    "typedef double complex double_complex;\n"
+    "typedef long double complex long_double_complex;\n"
+    "#endif\n\n";
+
+    if (options_.arrayExtents) {
+        // C++ has neither [static N] nor restrict in array declarators
+        out << "#ifdef __cplusplus\n"
+        "#define F2H_RESTRICT __restrict\n"
+        "#define F2H_ARRAY_RESTRICT\n"
+        "#define F2H_STATIC\n"
+        "#else\n"
+        "#define F2H_RESTRICT restrict\n"
+        "#define F2H_ARRAY_RESTRICT restrict\n"
+        "#define F2H_STATIC static\n"
+        "#endif\n\n";
+    }
+}
+
+/**
+ * Writes the C++ views, string and result overloads of \p subprograms and \p commons,
+ * preceded by the support code they use if \p support is set.
+ */
+void Generator::writeCxx(raw_ostream &out, const std::vector<Subprogram::Handle> &subprograms,
+                         const std::vector<CommonBlock::Handle> &commons, bool support)
+{
+    bool views = options_.cxxViews && (support || !subprograms.empty() || !commons.empty());
+    bool strings = options_.cxxStrings && (support || !subprograms.empty());
+    bool results = options_.cxxResults && (support || !subprograms.empty());
+    if (!views && !strings && !results) {
+        return;
+    }
+
+    out << "\n#ifdef __cplusplus\n";
+    if (views) {
+        if (support) {
+            CxxSupport::writeArrayView(out);
+        }
+        out << "\nnamespace f2h {\n";
+        for (auto sub : subprograms) {
+            sub->cxxViews(out);
+        }
+        for (auto cb : commons) {
+            cb->cxxViews(out);
+        }
+        out << "}\n\n";
+    }
+    if (strings) {
+        // overloads of the extern "C" functions, they differ in the number of arguments
+        if (support) {
+            CxxSupport::writeCharArg(out);
+        }
+        out << '\n';
+        // the same subprogram can be declared for several units, but an inline function only defined once
+        for (auto sub : subprograms) {
+            if (stringOverloads_.insert(sub->linkageName_).second) {
+                sub->cxxStringOverload(out, options_.arrayExtents);
+            }
+        }
+        out << '\n';
+    }
+    if (results) {
+        if (support) {
+            CxxSupport::writeResultBuffers(out);
+        }
+        out << '\n';
+        for (auto sub : subprograms) {
+            if (resultOverloads_.insert(sub->linkageName_).second) {
+                sub->cxxResultOverload(out, options_.arrayExtents, options_.cxxStrings);
+            }
+        }
+        out << '\n';
+    }
+    out << "#endif\n";
+}
+
+/**
+ * Merges the common blocks of \p unit into commons_ and its module variables
+ * into moduleVariables_, and adds the derived types and descriptors they and
+ * its subprograms use to types_ and descriptorRanks_.  The descriptor members
+ * of the types are left to writeDescriptors.
+ */
+void Generator::mergeUnit(const UnitModel &unit)
+{
+    CommonBlock::merge(unit.commons, commons_);
+    auto collect = [this](const Variable &var) {
+        DerivedType::collect(var, types_, typeNames_);
+        if (var.descriptorRank_) {
+            descriptorRanks_.insert(var.descriptorRank_);
+        }
+    };
+    for (auto sub : unit.subprograms) {
+        if (sub->returnVal_) {
+            collect(*sub->returnVal_);
+        }
+        for (auto arg : sub->args_) {
+            collect(*arg);
+        }
+    }
+    for (auto &cbit : unit.commons) {
+        for (auto v : cbit.second->members()) {
+            collect(*v);
+        }
+    }
+    for (auto v : unit.moduleVariables) {
+        collect(*v);
+        moduleVariables_.push_back(v);
+    }
+}
+
+/// Writes the array descriptor structs of the ranks in descriptorRanks_ and of the members of types_.
+void Generator::writeDescriptors(raw_ostream &out) const
+{
+    // types_ has every type reachable from the declarations, so their members need no recursion
+    std::set<unsigned> ranks = descriptorRanks_;
+    for (auto &tit : types_) {
+        for (auto m : tit.second->members_) {
+            if (m->descriptorRank_) {
+                ranks.insert(m->descriptorRank_);
+            }
+        }
+    }
+    if (ranks.empty()) {
+        return;
+    }
+    ArrayDescriptor::writeSupport(out);
+    for (unsigned rank : ranks) {
+        ArrayDescriptor::writeRank(out, rank);
+    }
+}
+
+/// Writes the struct of each derived type in types_, the types a struct uses come first.
+void Generator::writeTypes(raw_ostream &out) const
+{
+    if (types_.empty()) {
+        return;
+    }
+    out << "// derived types\n";
+    for (auto &tit : types_) {
+        try {
+            tit.second->cDefinition(out);
+            out << '\n';
+            Stats::add(Stats::DerivedTypes);
+        } catch (std::runtime_error &ex) {
+            errs() << "skipping derived type " << tit.first << ": " << ex.what() << '\n';
+        }
+    }
+}
+
+/// Writes an extern declaration for each module variable, once per symbol.
+void Generator::writeModuleVariables(raw_ostream &out) const
+{
+    if (moduleVariables_.empty()) {
+        return;
+    }
+    out << "\n// module variables\n";
+    std::set<StringRef> names;
+    for (auto v : moduleVariables_) {
+        if (!names.insert(v->name_).second) {
+            continue;
+        }
+        try {
+            v->checkDeclaration();
+            out << "extern ";
+            v->cDeclaration(out);
+            out << ";\n";
+            Stats::add(Stats::ModuleVariables);
+        } catch (std::runtime_error &ex) {
+            // such as a scalar POINTER, which has no C equivalent
+            errs() << "skipping module variable " << v->name_ << ": " << ex.what() << '\n';
+            Stats::add(Stats::ModuleVariablesSkipped);
+        }
+    }
+}
+
+/// \return the common blocks in commons_ in the order they are declared.
+std::vector<CommonBlock::Handle> Generator::commonBlockList() const
+{
+    std::vector<CommonBlock::Handle> r;
+    for (auto &cbit : commons_) {
+        r.push_back(cbit.second);
+    }
+    return r;
+}
+
+void Generator::writeHeader(raw_ostream &out)
+{
+    Stats::Timer timer(Stats::Emit);
+    declared_.clear();
+    stringOverloads_.clear();
+    resultOverloads_.clear();
+    commons_.clear();
+    types_.clear();
+    descriptorRanks_.clear();
+    moduleVariables_.clear();
+
+    // the structs have to come before anything that uses them
+    for (auto &input : inputs_) {
+        for (auto &object : input.models) {
+            for (auto &unit : object.units) {
+                mergeUnit(unit);
+            }
+        }
+    }
+
+    // output header
+    out << "// automatically generated by f2h\n\n";
+    writePrelude(out);
+    writeDescriptors(out);
+    out << externC;
+    writeTypes(out);
+
+    for (auto &input : inputs_) {
+        for (auto &object : input.models) {
+            for (auto &unit : object.units) {
+                emitUnit(unit, out, declared_);
+            }
+        }
+    }
+    
+    // output common blocks
+    out << "\n\n// common blocks\n";
+    for (auto &cbit : commons_) {
+        cbit.second->cDeclaration(out);
+        out << '\n';
+    }
+    writeModuleVariables(out);
+
+    out << endExternC;
+
+    writeCxx(out, declared_, commonBlockList(), true);
+}
+
+/**
+ * Compile units are grouped by their source file, so a header only changes
+ * when one of its sources does.  Units with the same name, such as the same
+ * source in two objects, share a header.  Different sources with the same
+ * file name get a number to tell them apart.
+ */
+std::vector<Generator::OutputFile> Generator::writeSplitHeader(const std::string &umbrella)
+{
+    Stats::Timer timer(Stats::Emit);
+    declared_.clear();
+    stringOverloads_.clear();
+    resultOverloads_.clear();
+    commons_.clear();
+    types_.clear();
+    descriptorRanks_.clear();
+    moduleVariables_.clear();
+
+    StringRef stem = sys::path::stem(umbrella);
+    std::vector<OutputFile> files;
+    std::map<std::string, size_t> sources;
+    std::set<std::string> names;
+    std::vector<std::vector<Subprogram::Handle> > declared;
+
+    files.push_back(OutputFile());
+    files.back().name = (stem + "_types.h").str();
+    files.push_back(OutputFile());
+    files.back().name = (stem + "_common.h").str();
+    names.insert(files[0].name);
+    names.insert(files[1].name);
+
+    for (auto &input : inputs_) {
+        for (auto &object : input.models) {
+            for (auto &unit : object.units) {
+                mergeUnit(unit);
+                if (!unit.isFortran || (selector_ && unit.subprograms.empty())) {
+                    continue;
+                }
+                auto inserted = sources.insert(std::make_pair(unit.name, files.size()));
+                if (inserted.second) {
+                    std::string base = (stem + "_" + identifier(sys::path::stem(unit.name))).str();
+                    std::string name = base + ".h";
+                    for (unsigned n = 2; !names.insert(name).second; ++n) {
+                        name = base + "_" + std::to_string(n) + ".h";
+                    }
+                    files.push_back(OutputFile());
+                    files.back().name = name;
+                    declared.push_back(std::vector<Subprogram::Handle>());
+                    raw_string_ostream out(files.back().contents);
+                    openSplitHeader(out, name);
+                    out << "#include \"" << files[0].name << "\"\n\n" << externC;
+                }
+                size_t i = inserted.first->second;
+                raw_string_ostream out(files[i].contents);
+                emitUnit(unit, out, declared[i - 2]);
+            }
+        }
+    }
+
+    for (size_t i=2; i<files.size(); ++i) {
+        raw_string_ostream out(files[i].contents);
+        out << endExternC;
+        writeCxx(out, declared[i - 2], std::vector<CommonBlock::Handle>(), false);
+        out << "\n#endif\n";
+        declared_.insert(declared_.end(), declared[i - 2].begin(), declared[i - 2].end());
+    }
+
+    {
+        raw_string_ostream out(files[0].contents);
+        openSplitHeader(out, files[0].name);
+        writePrelude(out);
+        if (options_.cxxViews || options_.cxxStrings || options_.cxxResults) {
+            out << "#ifdef __cplusplus\n";
+            if (options_.cxxViews) {
+                CxxSupport::writeArrayView(out);
+            }
+            if (options_.cxxStrings) {
+                CxxSupport::writeCharArg(out);
+            }
+            if (options_.cxxResults) {
+                CxxSupport::writeResultBuffers(out);
+            }
+            out << "#endif\n\n";
+        }
+        writeDescriptors(out);
+        writeTypes(out);
+        out << "#endif\n";
+    }
+
+    {
+        raw_string_ostream out(files[1].contents);
+        openSplitHeader(out, files[1].name);
+        out << "#include \"" << files[0].name << "\"\n\n" << externC;
+        for (auto &cbit : commons_) {
+            cbit.second->cDeclaration(out);
+            out << '\n';
+        }
+        writeModuleVariables(out);
+        out << endExternC;
+        writeCxx(out, std::vector<Subprogram::Handle>(), commonBlockList(), false);
+        out << "\n#endif\n";
+    }
+
+    files.push_back(OutputFile());
+    files.back().name = sys::path::filename(umbrella).str();
+    raw_string_ostream out(files.back().contents);
+    openSplitHeader(out, files.back().name);
+    for (size_t i=0; i+1<files.size(); ++i) {
+        out << "#include \"" << files[i].name << "\"\n";
+    }
+    out << "\n#endif\n";
+    out.flush();
+    return files;
+}
+
+void Generator::writeLayoutReport(raw_ostream &out, unsigned cacheLineSize, LayoutReport::Format format) const
+{
+    LayoutReport report(cacheLineSize);
+    for (auto &cbit : commons_) {
+        report.add(*cbit.second);
+    }
+    report.write(out, format);
+}
@@ -0,0 +1,199 @@
+#ifndef Generator_hpp
+#define Generator_hpp
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "llvm/Support/MemoryBuffer.h"
+#include "CommonBlock.hpp"
+#include "DerivedType.hpp"
+#include "Die.hpp"
+#include "LayoutReport.hpp"
+#include "ObjectModel.hpp"
+#include "Subprogram.hpp"
+#include "SymbolSelector.hpp"
+#include "TypeUnits.hpp"
+
+namespace llvm {
+class DWARFUnit;
+class raw_ostream;
+class ThreadPool;
+}
+
+class MappedFile;
+class ModelCache;
+class TimeTrace;
+struct LoadedObject;
+
+/**
+ * Extracts the FORTRAN interfaces of a list of inputs and writes the header
+ * and the other outputs for them.  This is libf2h, the f2h tool is a command
+ * line around it.
+ *
+ * Each generator has its own options, thread pool, cache and common blocks,
+ * so independent generators can be used concurrently in one process.  One
+ * generator is used by one thread at a time.  The counters of --f2h-stats are the
+ * only state shared by all of them.
+ *
+ * Errors are reported to llvm::errs() as they happen and an input that can't
+ * be read contributes nothing; failed() tells whether there were any.
+ */
+class Generator
+{
+public:
+    struct Options
+    {
+        /// threads extracting objects and compile units, 0 for one per hardware thread
+        unsigned jobs = 1;
+        /// reuse models cached in this directory, none if empty
+        std::string cacheDirectory;
+        /// only declare these subprograms, see SymbolSelector
+        std::vector<std::string> symbols;
+        bool exportedOnly = false;
+        /// read the subprograms through the name index where there is one, see AcceleratorIndex
+        bool nameIndex = false;
+        /**
+         * copy the names into the models instead of referencing them in the mapped
+         * inputs, for models kept while a compiler may rewrite an input in place
+         */
+        bool copyNames = false;
+        /// declare arguments with their extents, see Variable::cDeclaration
+        bool arrayExtents = false;
+        bool cxxViews = false;
+        bool cxxStrings = false;
+        bool cxxResults = false;
+    };
+
+    /// Throws std::runtime_error if the symbol selection can't be read.
+    explicit Generator(const Options &options);
+    ~Generator();
+    Generator(const Generator &) = delete;
+    Generator &operator=(const Generator &) = delete;
+
+    /**
+     * Adds an object file, archive or .dwo file to the inputs.  Nothing is
+     * read until extract().
+     * \return the index of the input.
+     */
+    size_t addFile(const std::string &filename);
+
+    /**
+     * Adds an object file or archive in memory, reported as \p name.  The
+     * model refers to names in \p buffer, which must outlive the generator.
+     */
+    size_t addBuffer(llvm::MemoryBufferRef buffer, const std::string &name);
+
+    size_t inputCount() const { return inputs_.size(); }
+
+    /**
+     * Extracts all the inputs, or just those at \p inputs, replacing any
+     * models extracted before.  Returns once all the jobs are done.  The jobs
+     * for input i record into traces[i] if it is given and not null.
+     */
+    void extract(const std::vector<TimeTrace *> &traces = std::vector<TimeTrace *>());
+    void extract(const std::vector<size_t> &inputs, const std::vector<TimeTrace *> &traces);
+
+    /**
+     * Writes the header for the extracted models in input order: the derived
+     * types, the subprograms, the common blocks and the module variables.
+     * Also determines the declared subprograms and the common blocks, which
+     * the other outputs need.
+     */
+    void writeHeader(llvm::raw_ostream &out);
+
+    /// A file written by writeSplitHeader.
+    struct OutputFile
+    {
+        /// name relative to the directory of the umbrella header
+        std::string name;
+        std::string contents;
+    };
+
+    /**
+     * Returns the header split into one per source file, one with the common
+     * blocks and module variables, one with the types and macros the others share and the
+     * umbrella header named \p umbrella, last, which includes all the others.
+     * Their names start with the stem of \p umbrella, so foo.h comes with
+     * foo_types.h, foo_common.h and foo_<source>.h for each source file.
+     * Determines the declared subprograms and the common blocks like writeHeader.
+     */
+    std::vector<OutputFile> writeSplitHeader(const std::string &umbrella);
+
+    /// Writes the --emit-model, binary or as JSON.  Needs one of the header writers first.
+    void writeModel(llvm::raw_ostream &out, bool json) const;
+
+    /// Writes a Python module with the NumPy dtypes of the common blocks.  Needs a header writer first.
+    void writePythonModule(llvm::raw_ostream &out) const;
+
+    /// Writes the layout report of the common blocks.  Needs a header writer first.
+    void writeLayoutReport(llvm::raw_ostream &out, unsigned cacheLineSize, LayoutReport::Format format) const;
+
+    /// The common blocks merged by the last header writer.
+    const CommonBlock::CommonMap &commonBlocks() const { return commons_; }
+
+    /// \return true if any error was reported by the last extract.
+    bool failed() const { return failed_; }
+
+private:
+    struct Input
+    {
+        std::string name;
+        /// for inputs added with addBuffer, empty otherwise
+        llvm::MemoryBufferRef buffer;
+        std::vector<ObjectModel> models;
+    };
+
+    bool error(llvm::StringRef filename, std::error_code ec);
+
+    template <typename Task>
+    void dispatch(Task task);
+
+    std::shared_ptr<MappedFile> openFile(const std::string &filename);
+    std::shared_ptr<LoadedObject> openObject(const std::string &filename);
+    bool loadObjectFile(const std::string &filename, LoadedObject &loaded);
+    bool loadDebugInfo(const std::string &filename, LoadedObject &loaded);
+    void setTypeUnits(LoadedObject &loaded, bool dwo);
+    void extractSplitUnit(Die skeleton, llvm::StringRef dwoName, const SymbolSelector::Selection *symbols,
+                          UnitModel &result);
+    void extractUnit(llvm::DWARFUnit &cu, const std::vector<Die::Offset> *subprograms,
+                     const std::vector<Die::Offset> *modules, const SymbolSelector::Selection *symbols,
+                     UnitModel &result);
+    void extractObject(std::shared_ptr<LoadedObject> loaded, const std::string &filename, ObjectModel &result);
+    void extractArchive(std::shared_ptr<MappedFile> file, llvm::MemoryBufferRef buffer,
+                        const std::string &filename, std::vector<ObjectModel> &results);
+    void extractInput(Input &input);
+    void mergeUnit(const UnitModel &unit);
+    void emitUnit(const UnitModel &unit, llvm::raw_ostream &out, std::vector<Subprogram::Handle> &declared);
+    void writeDescriptors(llvm::raw_ostream &out) const;
+    void writeTypes(llvm::raw_ostream &out) const;
+    void writeModuleVariables(llvm::raw_ostream &out) const;
+    void writePrelude(llvm::raw_ostream &out) const;
+    void writeCxx(llvm::raw_ostream &out, const std::vector<Subprogram::Handle> &subprograms,
+                  const std::vector<CommonBlock::Handle> &commons, bool support);
+    std::vector<CommonBlock::Handle> commonBlockList() const;
+
+    Options options_;
+    std::unique_ptr<llvm::ThreadPool> pool_;
+    std::unique_ptr<ModelCache> cache_;
+    std::unique_ptr<SymbolSelector> selector_;
+    std::vector<Input> inputs_;
+    std::vector<Subprogram::Handle> declared_;
+    /// linkage names of the subprograms with a string or result overload, each is only defined once
+    std::set<llvm::StringRef> stringOverloads_;
+    std::set<llvm::StringRef> resultOverloads_;
+    CommonBlock::CommonMap commons_;
+    DerivedType::TypeList types_;
+    /// struct names given to derived types with the name of another, see DerivedType::collect
+    std::set<std::string> typeNames_;
+    /// ranks of the array descriptors the declarations use
+    std::set<unsigned> descriptorRanks_;
+    std::vector<Variable::Handle> moduleVariables_;
+    /// types from type units, shared by all the objects
+    TypeUnits::Cache typeSignatures_;
+    std::atomic<bool> failed_;
+};
+
+#endif
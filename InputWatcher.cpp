@@ -0,0 +1,123 @@
+#include "InputWatcher.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+#ifdef __linux__
+
+InputWatcher::InputWatcher(const std::vector<std::string> &filenames)
+{
+    fd_ = inotify_init1(IN_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("failed to start watching the inputs: ") + std::strerror(errno));
+    }
+
+    std::map<std::string, int> directories;
+    for (size_t i=0; i<filenames.size(); ++i) {
+        SmallString<128> path(filenames[i]);
+        sys::fs::make_absolute(path);
+        std::string dir = sys::path::parent_path(path).str();
+        auto it = directories.find(dir);
+        if (it == directories.end()) {
+            int wd = inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd < 0) {
+                std::string message = "failed to watch " + dir + ": " + std::strerror(errno);
+                close(fd_);
+                throw std::runtime_error(message);
+            }
+            it = directories.insert(std::make_pair(dir, wd)).first;
+        }
+        watches_[it->second].insert(std::make_pair(sys::path::filename(path).str(), i));
+    }
+}
+
+InputWatcher::~InputWatcher()
+{
+    close(fd_);
+}
+
+void InputWatcher::read(std::vector<bool> &changed)
+{
+    alignas(inotify_event) char buf[16 * 1024];
+    ssize_t n = ::read(fd_, buf, sizeof(buf));
+    if (n < 0) {
+        if (errno == EINTR) {
+            return;
+        }
+        throw std::runtime_error(std::string("failed to read input changes: ") + std::strerror(errno));
+    }
+
+    for (char *p = buf; p < buf + n; ) {
+        const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+        p += sizeof(inotify_event) + event->len;
+        auto wit = watches_.find(event->wd);
+        if (wit == watches_.end() || !event->len) {
+            continue;
+        }
+        auto range = wit->second.equal_range(event->name);
+        for (auto it = range.first; it != range.second; ++it) {
+            changed[it->second] = true;
+        }
+    }
+}
+
+std::vector<size_t> InputWatcher::wait(std::chrono::milliseconds settle)
+{
+    size_t inputs = 0;
+    for (auto &watch : watches_) {
+        inputs += watch.second.size();
+    }
+    std::vector<bool> changed(inputs);
+
+    // events for other files in the same directories don't end the wait
+    pollfd pfd = { fd_, POLLIN, 0 };
+    bool any = false;
+    while (!any) {
+        read(changed);
+        any = std::find(changed.begin(), changed.end(), true) != changed.end();
+    }
+    while (poll(&pfd, 1, settle.count()) > 0) {
+        read(changed);
+    }
+
+    std::vector<size_t> r;
+    for (size_t i=0; i<changed.size(); ++i) {
+        if (changed[i]) {
+            r.push_back(i);
+        }
+    }
+    return r;
+}
+
+#else
+
+InputWatcher::InputWatcher(const std::vector<std::string> &) : fd_(-1)
+{
+    throw std::runtime_error("--watch needs inotify, which this system doesn't have");
+}
+
+InputWatcher::~InputWatcher()
+{
+}
+
+void InputWatcher::read(std::vector<bool> &)
+{
+}
+
+std::vector<size_t> InputWatcher::wait(std::chrono::milliseconds)
+{
+    return std::vector<size_t>();
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef InputWatcher_hpp
+#define InputWatcher_hpp
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Reports the input files that were rewritten, for --watch.
+ *
+ * The directories of the inputs are watched with inotify rather than the
+ * files themselves, because compilers and archivers often replace a file by
+ * renaming a new one over it.  A file counts as changed when it is closed
+ * after writing or renamed into place, so a half written object is never
+ * reported.
+ */
+class InputWatcher
+{
+public:
+    /**
+     * Starts watching \p filenames.  Throws std::runtime_error if a directory
+     * can't be watched or the system has no inotify.
+     */
+    explicit InputWatcher(const std::vector<std::string> &filenames);
+    ~InputWatcher();
+    InputWatcher(const InputWatcher &) = delete;
+    InputWatcher &operator=(const InputWatcher &) = delete;
+
+    /**
+     * Blocks until an input changes, then keeps collecting changes until none
+     * arrive for \p settle, so a build that writes several objects is handled
+     * at once.
+     * \return the indices of the changed inputs in the list given to the constructor.
+     */
+    std::vector<size_t> wait(std::chrono::milliseconds settle);
+
+private:
+    /// Adds the inputs named by the events that are ready to \p changed.
+    void read(std::vector<bool> &changed);
+
+    int fd_;
+    /// watch descriptor to the inputs in that directory, keyed by file name
+    std::map<int, std::multimap<std::string, size_t> > watches_;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include "LayoutReport.hpp"
+#include "ArrayDescriptor.hpp"
+#include "DerivedType.hpp"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <map>
+
+using namespace llvm;
+
+namespace {
+
+/**
+ * Alignment the member's type asks for, complex numbers align like their parts,
+ * descriptors like pointers and derived types like their most aligned member.
+ */
+uint64_t naturalAlignment(const Variable &var)
+{
+    if (var.descriptorRank_) {
+        return var.elementSize() == ArrayDescriptor::size(var.descriptorRank_, 8) ? 8 : 4;
+    }
+    if (var.derived_) {
+        uint64_t r = 1;
+        for (auto &m : var.derived_->members_) {
+            r = std::max(r, naturalAlignment(*m));
+        }
+        return r;
+    }
+    if (var.isString()) {
+        return 1;
+    }
+    uint64_t r = var.type_ == dwarf::DW_ATE_complex_float ? var.elementSize() / 2 : var.elementSize();
+    return r ? r : 1;
+}
+
+void writeLines(raw_ostream &os, uint64_t first, uint64_t last)
+{
+    os << first;
+    if (last != first) {
+        os << "-" << last;
+    }
+}
+
+}
+
+LayoutReport::LayoutReport(unsigned lineSize) : lineSize_(lineSize ? lineSize : 64)
+{
+
+}
+
+void LayoutReport::add(const CommonBlock &cb)
+{
+    Block block;
+    block.name = cb.name_;
+    block.linkageName = cb.linkageName_;
+    block.address = cb.address_;
+    block.size = 0;
+    block.padding = 0;
+
+    auto line = [&](uint64_t offset) {
+        return (block.address + offset) / lineSize_ - block.address / lineSize_;
+    };
+
+    // only the first and last line of a member can hold another member
+    std::map<uint64_t, std::vector<StringRef> > lineMembers;
+    for (auto &v : cb.vars_) {
+        Member m;
+        m.name = v->name_;
+        m.offset = v->location_;
+        m.address = block.address + m.offset;
+        m.size = v->elementSize() * v->elementCount();
+        m.alignment = naturalAlignment(*v);
+        m.firstLine = line(m.offset);
+        m.lastLine = line(m.offset + (m.size ? m.size - 1 : 0));
+        m.padding = v->isPadding();
+        if (m.padding) {
+            block.padding += m.size;
+        } else {
+            lineMembers[m.firstLine].push_back(m.name);
+            if (m.lastLine != m.firstLine) {
+                lineMembers[m.lastLine].push_back(m.name);
+            }
+        }
+        block.size = std::max(block.size, m.offset + m.size);
+        block.members.push_back(m);
+    }
+    for (auto &lm : lineMembers) {
+        if (lm.second.size() > 1) {
+            block.sharedLines.push_back(SharedLine{lm.first, std::move(lm.second)});
+        }
+    }
+    blocks_.push_back(std::move(block));
+}
+
+void LayoutReport::write(raw_ostream &os, Format format) const
+{
+    switch (format) {
+        case Text:
+            writeText(os);
+            break;
+
+        case JSON:
+            writeJSON(os);
+            break;
+    }
+}
+
+std::vector<const LayoutReport::Block *> LayoutReport::sortedBlocks() const
+{
+    std::vector<const Block *> r;
+    for (auto &b : blocks_) {
+        r.push_back(&b);
+    }
+    std::sort(r.begin(), r.end(), [](const Block *a, const Block *b) { return a->name < b->name; });
+    return r;
+}
+
+void LayoutReport::writeText(raw_ostream &os) const
+{
+    auto blocks = sortedBlocks();
+
+    uint64_t misaligned = 0, straddling = 0, shared = 0, padding = 0;
+    for (auto b : blocks) {
+        os << "common /" << b->name << "/ " << b->linkageName << ": " << b->size << " bytes";
+        if (b->address) {
+            os << " at " << format_hex(b->address, 2);
+        }
+        os << ", " << lineSize_ << " byte lines\n";
+        os << "      offset        size  align  lines        member\n";
+        for (auto &m : b->members) {
+            os << format("  %10llu  %10llu  %5llu  ", (unsigned long long)m.offset,
+                         (unsigned long long)m.size, (unsigned long long)m.alignment);
+            std::string lines;
+            raw_string_ostream ls(lines);
+            writeLines(ls, m.firstLine, m.lastLine);
+            os << format("%-11s  ", ls.str().c_str()) << m.name;
+            if (m.padding) {
+                os << " (padding)";
+            }
+            if (m.misaligned()) {
+                os << " misaligned";
+                ++misaligned;
+            }
+            if (m.straddles()) {
+                os << " straddles " << m.lastLine - m.firstLine + 1 << " lines";
+                ++straddling;
+            }
+            os << "\n";
+        }
+        for (auto &sl : b->sharedLines) {
+            os << "  line " << sl.line << " shared by";
+            for (auto &name : sl.members) {
+                os << " " << name;
+            }
+            os << "\n";
+        }
+        os << "  padding " << b->padding << " bytes\n\n";
+        shared += b->sharedLines.size();
+        padding += b->padding;
+    }
+    os << blocks.size() << " common blocks, " << misaligned << " misaligned members, " << straddling
+       << " members straddling cache lines, " << shared << " shared cache lines, " << padding
+       << " bytes of padding\n";
+}
+
+/// Names are Fortran identifiers, so they are written without escaping.
+void LayoutReport::writeJSON(raw_ostream &os) const
+{
+    auto blocks = sortedBlocks();
+
+    uint64_t misaligned = 0, straddling = 0, shared = 0, padding = 0;
+    os << "{\"lineSize\":" << lineSize_ << ",\"blocks\":[";
+    bool firstBlock = true;
+    for (auto b : blocks) {
+        os << (firstBlock ? "\n" : ",\n");
+        firstBlock = false;
+        os << "{\"name\":\"" << b->name << "\",\"linkageName\":\"" << b->linkageName << "\",\"address\":";
+        if (b->address) {
+            os << b->address;
+        } else {
+            os << "null";
+        }
+        os << ",\"size\":" << b->size << ",\"padding\":" << b->padding << ",\"members\":[";
+        bool first = true;
+        for (auto &m : b->members) {
+            os << (first ? "" : ",");
+            first = false;
+            os << "\n {\"name\":\"" << m.name << "\",\"offset\":" << m.offset << ",\"size\":" << m.size
+               << ",\"alignment\":" << m.alignment << ",\"firstLine\":" << m.firstLine
+               << ",\"lastLine\":" << m.lastLine << ",\"padding\":" << (m.padding ? "true" : "false")
+               << ",\"misaligned\":" << (m.misaligned() ? "true" : "false")
+               << ",\"straddles\":" << (m.straddles() ? "true" : "false") << "}";
+            misaligned += m.misaligned();
+            straddling += m.straddles();
+        }
+        os << "],\"sharedLines\":[";
+        first = true;
+        for (auto &sl : b->sharedLines) {
+            os << (first ? "" : ",") << "{\"line\":" << sl.line << ",\"members\":[";
+            first = false;
+            for (size_t i=0; i<sl.members.size(); ++i) {
+                os << (i ? "," : "") << "\"" << sl.members[i] << "\"";
+            }
+            os << "]}";
+        }
+        os << "]}";
+        shared += b->sharedLines.size();
+        padding += b->padding;
+    }
+    os << "\n],\"totals\":{\"blocks\":" << blocks.size() << ",\"misaligned\":" << misaligned
+       << ",\"straddling\":" << straddling << ",\"sharedLines\":" << shared << ",\"padding\":" << padding
+       << "}}\n";
+}
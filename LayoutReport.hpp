@@ -0,0 +1,77 @@
+#ifndef LayoutReport_hpp
+#define LayoutReport_hpp
+
+#include <cstdint>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+#include "CommonBlock.hpp"
+
+namespace llvm {
+class raw_ostream;
+}
+
+/**
+ * Byte layout of common blocks for --layout-report: the offset, size and
+ * natural alignment of each member, the members that are misaligned or
+ * straddle a cache line, the cache lines shared by several members and the
+ * padding inserted between them.
+ *
+ * Cache lines are counted from the line holding the start of the block.  The
+ * address of a block is only known in a linked file, otherwise the block is
+ * assumed to start on a line and to be aligned for all its members.
+ */
+class LayoutReport
+{
+public:
+    enum Format {
+        Text,
+        JSON
+    };
+
+    explicit LayoutReport(unsigned lineSize);
+
+    /// Adds the layout of \p cb.
+    void add(const CommonBlock &cb);
+
+    /// Writes the blocks added so far, sorted by name, and the totals.
+    void write(llvm::raw_ostream &os, Format format) const;
+
+private:
+    struct Member {
+        llvm::StringRef name;
+        uint64_t offset;
+        /// offset from address 0 if the block's address is known, otherwise from the block
+        uint64_t address;
+        uint64_t size;
+        uint64_t alignment;
+        uint64_t firstLine;
+        uint64_t lastLine;
+        bool padding;
+        bool misaligned() const { return !padding && address % alignment; }
+        bool straddles() const { return !padding && firstLine != lastLine; }
+    };
+
+    struct SharedLine {
+        uint64_t line;
+        std::vector<llvm::StringRef> members;
+    };
+
+    struct Block {
+        llvm::StringRef name;
+        llvm::StringRef linkageName;
+        uint64_t address;
+        uint64_t size;
+        uint64_t padding;
+        std::vector<Member> members;
+        std::vector<SharedLine> sharedLines;
+    };
+
+    std::vector<const Block *> sortedBlocks() const;
+    void writeText(llvm::raw_ostream &os) const;
+    void writeJSON(llvm::raw_ostream &os) const;
+
+    unsigned lineSize_;
+    std::vector<Block> blocks_;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "MappedFile.hpp"
+#include "llvm/Support/Process.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+using namespace llvm;
+
+ErrorOr<std::unique_ptr<MappedFile> > MappedFile::open(const std::string &filename)
+{
+    std::unique_ptr<MappedFile> r(new MappedFile());
+    r->filename_ = filename;
+
+    uint64_t size = 0;
+    if (filename != "-") {
+        if (std::error_code ec = sys::fs::file_size(filename, size)) {
+            return ec;
+        }
+    }
+
+    if (size == 0) {
+        auto bufOrErr = MemoryBuffer::getFileOrSTDIN(filename, -1, false);
+        if (!bufOrErr) {
+            return bufOrErr.getError();
+        }
+        r->contents_ = std::move(bufOrErr.get());
+        return std::move(r);
+    }
+
+    int fd;
+    if (std::error_code ec = sys::fs::openFileForRead(filename, fd)) {
+        return ec;
+    }
+    std::error_code ec;
+    r->region_.reset(new sys::fs::mapped_file_region(fd, sys::fs::mapped_file_region::readonly, size, 0, ec));
+    sys::Process::SafelyCloseFileDescriptor(fd);
+    if (ec) {
+        return ec;
+    }
+
+#ifndef _WIN32
+    // only the debug sections are read, and not sequentially
+    ::posix_madvise(const_cast<char *>(r->region_->const_data()), size, POSIX_MADV_RANDOM);
+#endif
+
+    return std::move(r);
+}
+
+MemoryBufferRef MappedFile::buffer() const
+{
+    if (contents_) {
+        return contents_->getMemBufferRef();
+    }
+    return MemoryBufferRef(StringRef(region_->const_data(), region_->size()), filename_);
+}
@@ -0,0 +1,36 @@
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <memory>
+#include <string>
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+/**
+ * A read-only memory mapping of an input file.
+ *
+ * Nothing is read up front.  DWARFContextInMemory refers to uncompressed
+ * sections in place, so the only pages that become resident are the section
+ * headers and the parts of .debug_info, .debug_abbrev, .debug_str and
+ * .debug_line that are actually visited.  Read-ahead is disabled because it
+ * would mostly pull in code and data from large shared libraries.
+ *
+ * Standard input and empty files, which cannot be mapped, are read into memory.
+ */
+class MappedFile
+{
+public:
+    static llvm::ErrorOr<std::unique_ptr<MappedFile> > open(const std::string &filename);
+
+    llvm::MemoryBufferRef buffer() const;
+
+private:
+    MappedFile() {}
+
+    std::string filename_;
+    std::unique_ptr<llvm::sys::fs::mapped_file_region> region_;
+    std::unique_ptr<llvm::MemoryBuffer> contents_;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "ModelArena.hpp"
+#include <cstring>
+
+using namespace llvm;
+
+StringRef ModelArena::intern(StringRef s)
+{
+    for (auto &contents : retained_) {
+        if (s.begin() >= contents.begin() && s.end() <= contents.end()) {
+            return s;
+        }
+    }
+
+    auto fit = strings_.find(s);
+    if (fit != strings_.end()) {
+        return *fit;
+    }
+
+    // keep the terminator so the copy can still be used as a C string
+    char *p = allocator_.Allocate<char>(s.size() + 1);
+    std::memcpy(p, s.data(), s.size());
+    p[s.size()] = '\0';
+    StringRef r(p, s.size());
+    strings_.insert(r);
+    return r;
+}
+
+void ModelArena::retain(std::shared_ptr<const void> owner, StringRef contents)
+{
+    owners_.push_back(std::move(owner));
+    retained_.push_back(contents);
+}
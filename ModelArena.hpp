@@ -0,0 +1,93 @@
+#ifndef ModelArena_hpp
+#define ModelArena_hpp
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+
+class TypeUnits;
+
+/**
+ * Owns the memory behind the model extracted from one compile unit.
+ *
+ * Variables, subprograms, common blocks and their arrays are bump allocated
+ * and freed all at once with the arena, so they must be trivially destructible.
+ * Names that lie inside a retained input buffer, such as .debug_str or the
+ * inline strings of .debug_info in a mapped object file, are referenced in
+ * place.  Anything else is copied into the arena once and shared by every
+ * later use of the same name.
+ *
+ * An arena is only used by one thread at a time.
+ */
+class ModelArena
+{
+public:
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocator_.Allocate<T>()) T(std::forward<Args>(args)...);
+    }
+
+    /// \return a copy of \p a that lives as long as the arena.
+    template <typename T>
+    llvm::ArrayRef<T> copy(llvm::ArrayRef<T> a)
+    {
+        if (a.empty()) {
+            return llvm::ArrayRef<T>();
+        }
+        T *r = allocator_.Allocate<T>(a.size());
+        std::uninitialized_copy(a.begin(), a.end(), r);
+        return llvm::ArrayRef<T>(r, a.size());
+    }
+
+    /// \return \p s, referenced in place if it is in a retained buffer and copied otherwise.
+    llvm::StringRef intern(llvm::StringRef s);
+
+    /// Keeps \p owner alive with the arena so names inside \p contents can be referenced in place.
+    void retain(std::shared_ptr<const void> owner, llvm::StringRef contents);
+
+    /// What a DIE was resolved to, a DIE can be memoized as each.
+    enum Memo {
+        Types,
+        DerivedTypes
+    };
+
+    /**
+     * Something resolved from the DIE at \p offset in \p unit, such as a
+     * Variable::Type, that was allocated in the arena.  Lets the DIEs that
+     * many others refer to be decoded once.
+     * \return null if nothing was memoized for the DIE.
+     */
+    const void *memoized(const void *unit, uint64_t offset, Memo memo = Types) const
+    {
+        auto it = memo_[memo].find(std::make_pair(unit, offset));
+        return it == memo_[memo].end() ? nullptr : it->second;
+    }
+
+    void memoize(const void *unit, uint64_t offset, const void *resolved, Memo memo = Types)
+    {
+        memo_[memo][std::make_pair(unit, offset)] = resolved;
+    }
+
+    /// Type units of the object while one of its units is extracted, null otherwise.
+    const TypeUnits *typeUnits() const { return typeUnits_; }
+    void useTypeUnits(const TypeUnits *typeUnits) { typeUnits_ = typeUnits; }
+
+private:
+    llvm::BumpPtrAllocator allocator_;
+    llvm::DenseSet<llvm::StringRef> strings_;
+    std::vector<std::shared_ptr<const void> > owners_;
+    std::vector<llvm::StringRef> retained_;
+    llvm::DenseMap<std::pair<const void *, uint64_t>, const void *> memo_[2];
+    const TypeUnits *typeUnits_ = nullptr;
+};
+
+#endif
@@ -0,0 +1,390 @@
+#include "ModelCache.hpp"
+#include "ObjectModel.hpp"
+#include "DerivedType.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace llvm;
+
+namespace {
+
+/// Bump whenever the layout of an entry or the extracted model changes.
+const uint32_t formatVersion = 7;
+const char magic[8] = { 'f', '2', 'h', 'c', 'a', 'c', 'h', 'e' };
+
+template <typename T>
+void writeValue(raw_ostream &os, T value)
+{
+    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeString(raw_ostream &os, StringRef s)
+{
+    writeValue<uint32_t>(os, s.size());
+    os << s;
+}
+
+}
+
+/// Reads back what the write functions wrote, throwing if the entry is truncated.
+class ModelCache::Reader
+{
+public:
+    explicit Reader(StringRef data) : data_(data), offset_(0) {}
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    /// \return the string in place, the caller keeps the entry's buffer alive.
+    StringRef readString()
+    {
+        uint32_t size = read<uint32_t>();
+        return StringRef(take(size), size);
+    }
+
+    bool atEnd() const { return offset_ == data_.size(); }
+
+private:
+    const char *take(size_t size)
+    {
+        if (size > data_.size() - offset_) {
+            throw std::runtime_error("ModelCache--truncated entry");
+        }
+        const char *r = data_.data() + offset_;
+        offset_ += size;
+        return r;
+    }
+
+    StringRef data_;
+    size_t offset_;
+};
+
+namespace {
+
+/// The derived types whose members are being written or read, outermost first.
+template <typename T>
+using Enclosing = SmallVector<T, 4>;
+
+void writeVariable(raw_ostream &os, const Variable &var, Enclosing<const DerivedType *> &enclosing);
+
+/**
+ * Derived types are written with every variable of the type, they are small.
+ * A member of an enclosing type, as in a type with an array of itself, is
+ * written as the index of that type.
+ */
+void writeDerivedType(raw_ostream &os, const DerivedType &type, Enclosing<const DerivedType *> &enclosing)
+{
+    auto it = std::find(enclosing.begin(), enclosing.end(), &type);
+    if (it != enclosing.end()) {
+        writeValue<uint8_t>(os, 2);
+        writeValue<uint32_t>(os, it - enclosing.begin());
+        return;
+    }
+    writeValue<uint8_t>(os, 1);
+    writeString(os, type.name_);
+    writeValue<uint64_t>(os, type.byteSize_);
+    writeValue<uint8_t>(os, type.failed_);
+    writeValue<uint32_t>(os, type.members_.size());
+    enclosing.push_back(&type);
+    for (auto &m : type.members_) {
+        writeVariable(os, *m, enclosing);
+    }
+    enclosing.pop_back();
+}
+
+void writeVariable(raw_ostream &os, const Variable &var, Enclosing<const DerivedType *> &enclosing)
+{
+    writeValue<uint8_t>(os, var.context_);
+    writeValue<uint32_t>(os, var.type_);
+    writeValue<uint64_t>(os, var.elementSize_);
+    writeValue<uint64_t>(os, var.location_);
+    writeString(os, var.name_);
+    writeValue<uint8_t>(os, var.isConst_);
+    writeValue<uint8_t>(os, var.descriptorRank_);
+    writeValue<uint64_t>(os, var.elementLength_);
+    writeValue<uint8_t>(os, var.isAllocatable_);
+    writeValue<uint32_t>(os, var.dims_.size());
+    for (auto &d : var.dims_) {
+        writeValue<uint8_t>(os, d.hasValue());
+        if (d.hasValue()) {
+            writeValue<int64_t>(os, d.getValue().first);
+            writeValue<int64_t>(os, d.getValue().second);
+        }
+    }
+    if (var.derived_) {
+        writeDerivedType(os, *var.derived_, enclosing);
+    } else {
+        writeValue<uint8_t>(os, 0);
+    }
+}
+
+void writeVariable(raw_ostream &os, const Variable &var)
+{
+    Enclosing<const DerivedType *> enclosing;
+    writeVariable(os, var, enclosing);
+}
+
+Variable::Handle readVariable(ModelCache::Reader &in, ModelArena &arena, Enclosing<DerivedType::Handle> &enclosing);
+
+DerivedType::Handle readDerivedType(ModelCache::Reader &in, ModelArena &arena, uint8_t kind,
+                                    Enclosing<DerivedType::Handle> &enclosing)
+{
+    if (kind == 2) {
+        uint32_t index = in.read<uint32_t>();
+        if (index >= enclosing.size()) {
+            throw std::runtime_error("ModelCache--bad derived type reference");
+        }
+        return enclosing[index];
+    }
+    DerivedType::Handle r = arena.make<DerivedType>();
+    r->name_ = in.readString();
+    r->byteSize_ = in.read<uint64_t>();
+    r->failed_ = in.read<uint8_t>() != 0;
+    uint32_t nmembers = in.read<uint32_t>();
+    SmallVector<Variable::Handle, 16> members;
+    enclosing.push_back(r);
+    for (uint32_t i=0; i<nmembers; ++i) {
+        members.push_back(readVariable(in, arena, enclosing));
+    }
+    enclosing.pop_back();
+    r->members_ = arena.copy<Variable::Handle>(members);
+    return r;
+}
+
+Variable::Handle readVariable(ModelCache::Reader &in, ModelArena &arena, Enclosing<DerivedType::Handle> &enclosing)
+{
+    Variable::Handle r = arena.make<Variable>();
+    r->context_ = static_cast<Variable::Context>(in.read<uint8_t>());
+    r->type_ = static_cast<dwarf::TypeKind>(in.read<uint32_t>());
+    r->elementSize_ = in.read<uint64_t>();
+    r->location_ = in.read<uint64_t>();
+    r->name_ = in.readString();
+    r->isConst_ = in.read<uint8_t>() != 0;
+    r->descriptorRank_ = in.read<uint8_t>();
+    r->elementLength_ = in.read<uint64_t>();
+    r->isAllocatable_ = in.read<uint8_t>() != 0;
+    uint32_t ndims = in.read<uint32_t>();
+    SmallVector<Variable::Dimension, 4> dims;
+    for (uint32_t i=0; i<ndims; ++i) {
+        Variable::Dimension d;
+        if (in.read<uint8_t>()) {
+            ptrdiff_t first = in.read<int64_t>();
+            ptrdiff_t second = in.read<int64_t>();
+            d = std::make_pair(first, second);
+        }
+        dims.push_back(d);
+    }
+    r->dims_ = arena.copy<Variable::Dimension>(dims);
+    // 0 for no derived type, see writeDerivedType for the others
+    uint8_t derived = in.read<uint8_t>();
+    if (derived) {
+        r->derived_ = readDerivedType(in, arena, derived, enclosing);
+    }
+    return r;
+}
+
+Variable::Handle readVariable(ModelCache::Reader &in, ModelArena &arena)
+{
+    Enclosing<DerivedType::Handle> enclosing;
+    return readVariable(in, arena, enclosing);
+}
+
+void writeSubprogram(raw_ostream &os, const Subprogram &sub)
+{
+    writeString(os, sub.name_);
+    writeString(os, sub.linkageName_);
+    writeValue<uint8_t>(os, sub.unsupported_);
+    writeValue<uint8_t>(os, sub.returnVal_ != nullptr);
+    if (sub.returnVal_) {
+        writeVariable(os, *sub.returnVal_);
+    }
+    writeValue<uint32_t>(os, sub.args_.size());
+    for (auto &arg : sub.args_) {
+        writeVariable(os, *arg);
+    }
+}
+
+Subprogram::Handle readSubprogram(ModelCache::Reader &in, ModelArena &arena)
+{
+    Subprogram::Handle r = arena.make<Subprogram>();
+    r->name_ = in.readString();
+    r->linkageName_ = in.readString();
+    r->unsupported_ = in.read<uint8_t>() != 0;
+    if (in.read<uint8_t>()) {
+        r->returnVal_ = readVariable(in, arena);
+    }
+    uint32_t nargs = in.read<uint32_t>();
+    SmallVector<Variable::Handle, 8> args;
+    for (uint32_t i=0; i<nargs; ++i) {
+        args.push_back(readVariable(in, arena));
+    }
+    r->args_ = arena.copy<Variable::Handle>(args);
+    return r;
+}
+
+}
+
+void ModelCache::write(raw_ostream &os, const CommonBlock &cb)
+{
+    writeString(os, cb.name_);
+    writeString(os, cb.linkageName_);
+    writeValue<uint64_t>(os, cb.address_);
+    writeValue<uint32_t>(os, cb.vars_.size());
+    for (auto &v : cb.vars_) {
+        writeVariable(os, *v);
+    }
+}
+
+CommonBlock *ModelCache::readCommonBlock(Reader &in, ModelArena &arena)
+{
+    CommonBlock *r = arena.make<CommonBlock>();
+    r->name_ = in.readString();
+    r->linkageName_ = in.readString();
+    r->address_ = in.read<uint64_t>();
+    uint32_t nvars = in.read<uint32_t>();
+    SmallVector<Variable::Handle, 8> vars;
+    for (uint32_t i=0; i<nvars; ++i) {
+        vars.push_back(readVariable(in, arena));
+    }
+    r->vars_ = arena.copy<Variable::Handle>(vars);
+    return r;
+}
+
+ModelCache::ModelCache(std::string directory) : directory_(std::move(directory))
+{
+    if (std::error_code ec = sys::fs::create_directories(directory_)) {
+        errs() << "failed to create cache directory " << directory_ << ": " << ec.message() << "\n";
+    }
+}
+
+std::string ModelCache::key(MemoryBufferRef buffer, StringRef variant)
+{
+    MD5 hash;
+    hash.update(StringRef(magic, sizeof(magic)));
+    hash.update(StringRef(reinterpret_cast<const char *>(&formatVersion), sizeof(formatVersion)));
+    hash.update(variant);
+    hash.update(buffer.getBuffer());
+    MD5::MD5Result result;
+    hash.final(result);
+    SmallString<32> str;
+    MD5::stringifyResult(result, str);
+    return std::string(str.str());
+}
+
+std::string ModelCache::path(const std::string &key) const
+{
+    SmallString<128> r(directory_);
+    sys::path::append(r, key + ".f2hc");
+    return std::string(r.str());
+}
+
+bool ModelCache::load(const std::string &key, ObjectModel &model) const
+{
+    auto bufOrErr = MemoryBuffer::getFile(path(key), -1, false);
+    if (!bufOrErr) {
+        return false;
+    }
+    // names are read in place, so every unit's arena holds on to the entry
+    std::shared_ptr<MemoryBuffer> buffer(std::move(bufOrErr.get()));
+
+    try {
+        Reader in(buffer->getBuffer());
+        for (char c : magic) {
+            if (in.read<char>() != c) {
+                throw std::runtime_error("ModelCache--not a cache entry");
+            }
+        }
+        if (in.read<uint32_t>() != formatVersion) {
+            throw std::runtime_error("ModelCache--unsupported version");
+        }
+
+        ObjectModel r;
+        r.units.resize(in.read<uint32_t>());
+        for (auto &unit : r.units) {
+            unit.arena->retain(buffer, buffer->getBuffer());
+            unit.isFortran = in.read<uint8_t>() != 0;
+            unit.name = in.readString().str();
+            uint32_t nsubs = in.read<uint32_t>();
+            for (uint32_t i=0; i<nsubs; ++i) {
+                unit.subprograms.push_back(readSubprogram(in, *unit.arena));
+            }
+            uint32_t ncommons = in.read<uint32_t>();
+            for (uint32_t i=0; i<ncommons; ++i) {
+                std::string name = in.readString().str();
+                unit.commons.insert(std::make_pair(name, readCommonBlock(in, *unit.arena)));
+            }
+            uint32_t nvars = in.read<uint32_t>();
+            for (uint32_t i=0; i<nvars; ++i) {
+                unit.moduleVariables.push_back(readVariable(in, *unit.arena));
+            }
+        }
+        if (!in.atEnd()) {
+            throw std::runtime_error("ModelCache--trailing data");
+        }
+        model = std::move(r);
+    } catch (std::runtime_error &ex) {
+        errs() << "ignoring cache entry " << path(key) << ": " << ex.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+void ModelCache::store(const std::string &key, const ObjectModel &model) const
+{
+    SmallString<128> tmpPath(directory_);
+    sys::path::append(tmpPath, "tmp-%%%%%%%%.f2hc");
+    int fd;
+    if (std::error_code ec = sys::fs::createUniqueFile(tmpPath, fd, tmpPath)) {
+        errs() << "failed to create cache entry in " << directory_ << ": " << ec.message() << "\n";
+        return;
+    }
+
+    {
+        raw_fd_ostream os(fd, true);
+        os.write(magic, sizeof(magic));
+        writeValue<uint32_t>(os, formatVersion);
+        writeValue<uint32_t>(os, model.units.size());
+        for (auto &unit : model.units) {
+            writeValue<uint8_t>(os, unit.isFortran);
+            writeString(os, unit.name);
+            writeValue<uint32_t>(os, unit.subprograms.size());
+            for (auto &sub : unit.subprograms) {
+                writeSubprogram(os, *sub);
+            }
+            writeValue<uint32_t>(os, unit.commons.size());
+            for (auto &cbit : unit.commons) {
+                writeString(os, cbit.first);
+                write(os, *cbit.second);
+            }
+            writeValue<uint32_t>(os, unit.moduleVariables.size());
+            for (auto &v : unit.moduleVariables) {
+                writeVariable(os, *v);
+            }
+        }
+        os.close();
+        if (os.has_error()) {
+            errs() << "failed to write cache entry " << tmpPath << "\n";
+            os.clear_error();
+            sys::fs::remove(tmpPath);
+            return;
+        }
+    }
+
+    // rename is atomic so concurrent readers never see a partial entry
+    if (std::error_code ec = sys::fs::rename(tmpPath, path(key))) {
+        errs() << "failed to store cache entry " << path(key) << ": " << ec.message() << "\n";
+        sys::fs::remove(tmpPath);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ModelCache_hpp
+#define ModelCache_hpp
+
+#include <memory>
+#include <string>
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace llvm {
+class raw_ostream;
+}
+
+struct ObjectModel;
+class CommonBlock;
+class ModelArena;
+
+/**
+ * On-disk cache of the models extracted from object files, keyed by a hash
+ * of the file contents.  An unchanged object is loaded from the cache without
+ * building a DWARF context or walking its DIEs.  Objects with split units
+ * are not cached, their .dwo files are not part of the key.
+ *
+ * Each entry is written to a temporary file and renamed into place so several
+ * f2h processes can share a cache directory.  Entries are in host byte order
+ * and are only meant to be read back on the machine that wrote them.
+ */
+class ModelCache
+{
+public:
+    /// Creates \p directory if it does not exist.
+    explicit ModelCache(std::string directory);
+
+    /**
+     * \return cache key for an object file with contents \p buffer.
+     * \p variant distinguishes models extracted with different options.
+     */
+    static std::string key(llvm::MemoryBufferRef buffer, llvm::StringRef variant = llvm::StringRef());
+
+    /**
+     * Replaces the contents of \p model with the cached entry for \p key.
+     * \return false if there is no usable entry, \p model is unchanged.
+     */
+    bool load(const std::string &key, ObjectModel &model) const;
+
+    /// Stores \p model under \p key.  Failures are reported but not fatal.
+    void store(const std::string &key, const ObjectModel &model) const;
+
+    /// Decodes cache entries, defined in ModelCache.cpp.
+    class Reader;
+
+private:
+    std::string path(const std::string &key) const;
+
+    // CommonBlock keeps its members private so these need to be members
+    static void write(llvm::raw_ostream &os, const CommonBlock &cb);
+    static CommonBlock *readCommonBlock(Reader &in, ModelArena &arena);
+
+    std::string directory_;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef ModelFormat_hpp
+#define ModelFormat_hpp
+
+#include <cstdint>
+
+/**
+ * Layout of the interface model written by --emit-model.
+ *
+ * A model file is a Header followed by six tables of fixed size records and a
+ * string table.  Records refer to each other by index and to strings by their
+ * offset in the string table, where they are NUL terminated, so the file can
+ * be used in place wherever it is mapped.  Tables start at multiples of 8
+ * bytes.  Subprograms, common blocks and module variables are sorted by
+ * linkage name and derived types by struct name for binary search.  Everything is in the byte order of the machine that wrote it, which
+ * byteOrder identifies.
+ *
+ * This header doesn't depend on LLVM so tools can use the model with just
+ * ModelReader.
+ */
+struct ModelFormat
+{
+    static constexpr char magic[8] = { 'f', '2', 'h', 'm', 'o', 'd', 'e', 'l' };
+
+    /// Bump whenever a record changes.
+    static constexpr uint32_t version = 6;
+
+    static constexpr uint32_t byteOrder = 0x01020304;
+
+    /// No return value, variable or common block.
+    static constexpr uint32_t none = 0xffffffff;
+
+    /// Values of Variable::context, as Variable::Context in f2h.
+    enum Context : uint8_t {
+        Parameter,
+        StringLengthParameter,
+        CommonBlockMember,
+        StructureMember,
+        ModuleVariable,
+        Result,
+        ResultLengthParameter
+    };
+
+    struct Table {
+        uint64_t offset;
+        uint32_t count;
+        uint32_t recordSize;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        Table subprograms;
+        Table variables;
+        Table commonBlocks;
+        Table dimensions;
+        /// count is the size in bytes
+        Table strings;
+        Table derivedTypes;
+        /// Variable records, named by their symbols
+        Table moduleVariables;
+    };
+
+    struct Subprogram {
+        uint32_t name;
+        uint32_t linkageName;
+        /// index of the first argument in the variables, the arguments are consecutive
+        uint32_t firstArg;
+        uint32_t argCount;
+        /// index of the return value in the variables or none
+        uint32_t returnValue;
+        uint32_t reserved;
+    };
+
+    struct Variable {
+        uint32_t name;
+        uint8_t context;
+        uint8_t isConst;
+        /// rank of an array passed or stored as a gfortran descriptor, 0 otherwise
+        uint8_t descriptorRank;
+        /// 1 for an ALLOCATABLE or POINTER descriptor, whose data the callee allocates
+        uint8_t isAllocatable;
+        /// DW_ATE encoding, 0 for a derived type
+        uint32_t type;
+        /// index of the first dimension, the dimensions are consecutive and in Fortran order
+        uint32_t firstDim;
+        uint32_t dimCount;
+        /// struct name of the derived type or none, see DerivedType::cName
+        uint32_t derivedType;
+        /// bytes per element, the length of a CHARACTER common block member, the size of a descriptor
+        uint64_t elementSize;
+        /// offset of a common block member in its block or of a derived type member in the type
+        uint64_t location;
+        /// bytes per element of a descriptor array, 0 otherwise
+        uint64_t elementLength;
+    };
+
+    struct CommonBlock {
+        uint32_t name;
+        uint32_t linkageName;
+        /// index of the first member in the variables, padding included
+        uint32_t firstVar;
+        uint32_t varCount;
+        /// 0 if unknown, as in an object file
+        uint64_t address;
+    };
+
+    struct DerivedType {
+        uint32_t name;
+        /// the name of the C struct, unique unlike the Fortran name
+        uint32_t cName;
+        /// index of the first member in the variables, padding included
+        uint32_t firstMember;
+        uint32_t memberCount;
+        uint64_t byteSize;
+    };
+
+    struct Dimension {
+        int64_t lower;
+        int64_t upper;
+        /// 0 if the bounds aren't constant
+        uint32_t known;
+        uint32_t reserved;
+    };
+};
+
+static_assert(sizeof(ModelFormat::Header) == 128, "ModelFormat::Header has padding");
+static_assert(sizeof(ModelFormat::Subprogram) == 24, "ModelFormat::Subprogram has padding");
+static_assert(sizeof(ModelFormat::Variable) == 48, "ModelFormat::Variable has padding");
+static_assert(sizeof(ModelFormat::CommonBlock) == 24, "ModelFormat::CommonBlock has padding");
+static_assert(sizeof(ModelFormat::DerivedType) == 24, "ModelFormat::DerivedType has padding");
+static_assert(sizeof(ModelFormat::Dimension) == 24, "ModelFormat::Dimension has padding");
+
+#endif
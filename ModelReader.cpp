@@ -0,0 +1,319 @@
+#include "ModelReader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char ModelFormat::magic[8];
+constexpr uint32_t ModelFormat::version;
+constexpr uint32_t ModelFormat::byteOrder;
+constexpr uint32_t ModelFormat::none;
+
+namespace {
+
+void writeString(std::ostream &os, const char *s)
+{
+    os << '"';
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            os << buf;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+}
+
+ModelReader::ModelReader(const std::string &path)
+{
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error(path + " is not an f2h model");
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("failed to map " + path + ": " + std::strerror(errno));
+    }
+    mapping_ = mapping;
+    size_ = st.st_size;
+    try {
+        open(static_cast<const char *>(mapping), st.st_size);
+    } catch (...) {
+        munmap(mapping_, size_);
+        throw;
+    }
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    contents_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    open(contents_.data(), contents_.size());
+#endif
+}
+
+ModelReader::ModelReader(const char *data, size_t size)
+{
+    open(data, size);
+}
+
+ModelReader::~ModelReader()
+{
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+#endif
+}
+
+void ModelReader::open(const char *data, size_t size)
+{
+    data_ = data;
+    size_ = size;
+    if (reinterpret_cast<uintptr_t>(data) % 8) {
+        throw std::runtime_error("f2h model is not 8 byte aligned");
+    }
+
+    const ModelFormat::Header *header = reinterpret_cast<const ModelFormat::Header *>(data);
+    if (size < sizeof(*header) || std::memcmp(header->magic, ModelFormat::magic, sizeof(ModelFormat::magic))) {
+        throw std::runtime_error("not an f2h model");
+    }
+    if (header->byteOrder != ModelFormat::byteOrder) {
+        throw std::runtime_error("f2h model was written with a different byte order");
+    }
+    if (header->version != ModelFormat::version) {
+        throw std::runtime_error("f2h model version " + std::to_string(header->version) +
+                                 ", expected " + std::to_string(ModelFormat::version));
+    }
+
+    subprograms_ = table<ModelFormat::Subprogram>(header->subprograms);
+    variables_ = table<ModelFormat::Variable>(header->variables);
+    commonBlocks_ = table<ModelFormat::CommonBlock>(header->commonBlocks);
+    dimensions_ = table<ModelFormat::Dimension>(header->dimensions);
+    derivedTypes_ = table<ModelFormat::DerivedType>(header->derivedTypes);
+    moduleVariables_ = table<ModelFormat::Variable>(header->moduleVariables);
+    Range<char> strings = table<char>(header->strings);
+    strings_ = strings.begin();
+    stringsSize_ = strings.size();
+    if (!stringsSize_ || strings_[stringsSize_ - 1]) {
+        throw std::runtime_error("f2h model string table is not terminated");
+    }
+}
+
+template <typename T>
+ModelReader::Range<T> ModelReader::table(const ModelFormat::Table &t) const
+{
+    if (t.recordSize != sizeof(T) || t.offset % alignof(T) || t.offset > size_ ||
+        (size_ - t.offset) / sizeof(T) < t.count) {
+        throw std::runtime_error("f2h model table is out of bounds");
+    }
+    const T *begin = reinterpret_cast<const T *>(data_ + t.offset);
+    return Range<T>{ begin, begin + t.count };
+}
+
+template <typename T>
+ModelReader::Range<T> ModelReader::slice(Range<T> all, uint32_t first, uint32_t count) const
+{
+    if (first > all.size() || count > all.size() - first) {
+        throw std::out_of_range("f2h model record index is out of range");
+    }
+    return Range<T>{ all.begin() + first, all.begin() + first + count };
+}
+
+const ModelFormat::Subprogram *ModelReader::findSubprogram(const char *linkageName) const
+{
+    auto it = std::lower_bound(subprograms_.begin(), subprograms_.end(), linkageName,
+                               [this](const ModelFormat::Subprogram &s, const char *name) {
+                                   return std::strcmp(string(s.linkageName), name) < 0;
+                               });
+    return it != subprograms_.end() && !std::strcmp(string(it->linkageName), linkageName) ? it : nullptr;
+}
+
+const ModelFormat::CommonBlock *ModelReader::findCommonBlock(const char *linkageName) const
+{
+    auto it = std::lower_bound(commonBlocks_.begin(), commonBlocks_.end(), linkageName,
+                               [this](const ModelFormat::CommonBlock &c, const char *name) {
+                                   return std::strcmp(string(c.linkageName), name) < 0;
+                               });
+    return it != commonBlocks_.end() && !std::strcmp(string(it->linkageName), linkageName) ? it : nullptr;
+}
+
+const ModelFormat::Variable *ModelReader::findModuleVariable(const char *linkageName) const
+{
+    auto it = std::lower_bound(moduleVariables_.begin(), moduleVariables_.end(), linkageName,
+                               [this](const ModelFormat::Variable &v, const char *name) {
+                                   return std::strcmp(string(v.name), name) < 0;
+                               });
+    return it != moduleVariables_.end() && !std::strcmp(string(it->name), linkageName) ? it : nullptr;
+}
+
+const ModelFormat::DerivedType *ModelReader::findDerivedType(const char *cName) const
+{
+    auto it = std::lower_bound(derivedTypes_.begin(), derivedTypes_.end(), cName,
+                               [this](const ModelFormat::DerivedType &t, const char *name) {
+                                   return std::strcmp(string(t.cName), name) < 0;
+                               });
+    return it != derivedTypes_.end() && !std::strcmp(string(it->cName), cName) ? it : nullptr;
+}
+
+ModelReader::Range<ModelFormat::Variable> ModelReader::arguments(const ModelFormat::Subprogram &sub) const
+{
+    return slice(variables_, sub.firstArg, sub.argCount);
+}
+
+const ModelFormat::Variable *ModelReader::returnValue(const ModelFormat::Subprogram &sub) const
+{
+    return sub.returnValue == ModelFormat::none ? nullptr : slice(variables_, sub.returnValue, 1).begin();
+}
+
+ModelReader::Range<ModelFormat::Variable> ModelReader::members(const ModelFormat::CommonBlock &cb) const
+{
+    return slice(variables_, cb.firstVar, cb.varCount);
+}
+
+ModelReader::Range<ModelFormat::Variable> ModelReader::members(const ModelFormat::DerivedType &type) const
+{
+    return slice(variables_, type.firstMember, type.memberCount);
+}
+
+ModelReader::Range<ModelFormat::Dimension> ModelReader::dimensions(const ModelFormat::Variable &var) const
+{
+    return slice(dimensions_, var.firstDim, var.dimCount);
+}
+
+const char *ModelReader::string(uint32_t offset) const
+{
+    if (offset >= stringsSize_) {
+        throw std::out_of_range("f2h model string offset is out of range");
+    }
+    return strings_ + offset;
+}
+
+void ModelReader::writeJSON(std::ostream &os) const
+{
+    auto writeVariable = [&](const ModelFormat::Variable &v) {
+        static const char *contexts[] = {
+            "parameter", "string length", "common block member", "structure member", "module variable",
+            "result", "result length"
+        };
+        os << "{\"name\":";
+        writeString(os, string(v.name));
+        os << ",\"context\":\"" << (v.context < 7 ? contexts[v.context] : "unknown")
+           << "\",\"type\":" << v.type;
+        if (v.descriptorRank) {
+            os << ",\"descriptorRank\":" << unsigned(v.descriptorRank) << ",\"elementLength\":" << v.elementLength
+               << ",\"allocatable\":" << (v.isAllocatable ? "true" : "false");
+        }
+        if (v.derivedType != ModelFormat::none) {
+            os << ",\"derivedType\":";
+            writeString(os, string(v.derivedType));
+        }
+        os << ",\"elementSize\":" << v.elementSize
+           << ",\"location\":" << v.location << ",\"const\":" << (v.isConst ? "true" : "false")
+           << ",\"dims\":[";
+        bool first = true;
+        for (auto &d : dimensions(v)) {
+            os << (first ? "" : ",");
+            first = false;
+            if (d.known) {
+                os << "[" << d.lower << "," << d.upper << "]";
+            } else {
+                os << "null";
+            }
+        }
+        os << "]}";
+    };
+
+    os << "{\"version\":" << ModelFormat::version << ",\"subprograms\":[";
+    bool first = true;
+    for (auto &s : subprograms_) {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        os << "{\"name\":";
+        writeString(os, string(s.name));
+        os << ",\"linkageName\":";
+        writeString(os, string(s.linkageName));
+        os << ",\"returnValue\":";
+        if (auto r = returnValue(s)) {
+            writeVariable(*r);
+        } else {
+            os << "null";
+        }
+        os << ",\"arguments\":[";
+        bool firstArg = true;
+        for (auto &a : arguments(s)) {
+            os << (firstArg ? "\n " : ",\n ");
+            firstArg = false;
+            writeVariable(a);
+        }
+        os << "]}";
+    }
+    os << "\n],\"commonBlocks\":[";
+    first = true;
+    for (auto &c : commonBlocks_) {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        os << "{\"name\":";
+        writeString(os, string(c.name));
+        os << ",\"linkageName\":";
+        writeString(os, string(c.linkageName));
+        os << ",\"address\":" << c.address << ",\"members\":[";
+        bool firstVar = true;
+        for (auto &v : members(c)) {
+            os << (firstVar ? "\n " : ",\n ");
+            firstVar = false;
+            writeVariable(v);
+        }
+        os << "]}";
+    }
+    os << "\n],\"derivedTypes\":[";
+    first = true;
+    for (auto &t : derivedTypes_) {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        os << "{\"name\":";
+        writeString(os, string(t.name));
+        os << ",\"cName\":";
+        writeString(os, string(t.cName));
+        os << ",\"byteSize\":" << t.byteSize << ",\"members\":[";
+        bool firstMember = true;
+        for (auto &m : members(t)) {
+            os << (firstMember ? "\n " : ",\n ");
+            firstMember = false;
+            writeVariable(m);
+        }
+        os << "]}";
+    }
+    os << "\n],\"moduleVariables\":[";
+    first = true;
+    for (auto &v : moduleVariables_) {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        writeVariable(v);
+    }
+    os << "\n]}\n";
+}
@@ -0,0 +1,99 @@
+#ifndef ModelReader_hpp
+#define ModelReader_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "ModelFormat.hpp"
+
+/**
+ * Read access to an interface model written by --emit-model.
+ *
+ * The file is mapped and the records are used in place.  Opening checks the
+ * header and that the tables lie within the file, nothing else is read until
+ * it is asked for.  Lookups by linkage name are binary searches.
+ *
+ * This is the f2hmodel library, it doesn't depend on LLVM.
+ */
+class ModelReader
+{
+public:
+    /// Consecutive records, such as the arguments of a subprogram.
+    template <typename T>
+    struct Range {
+        const T *begin_;
+        const T *end_;
+        const T *begin() const { return begin_; }
+        const T *end() const { return end_; }
+        size_t size() const { return end_ - begin_; }
+        const T &operator[](size_t i) const { return begin_[i]; }
+    };
+
+    /// Maps \p path.  Throws std::runtime_error if it can't be read or isn't a model of this version.
+    explicit ModelReader(const std::string &path);
+
+    /**
+     * Uses the model in \p data, which must stay valid and be 8 byte aligned.
+     * Throws like the other constructor.
+     */
+    ModelReader(const char *data, size_t size);
+
+    ~ModelReader();
+    ModelReader(const ModelReader &) = delete;
+    ModelReader &operator=(const ModelReader &) = delete;
+
+    Range<ModelFormat::Subprogram> subprograms() const { return subprograms_; }
+    Range<ModelFormat::CommonBlock> commonBlocks() const { return commonBlocks_; }
+    Range<ModelFormat::DerivedType> derivedTypes() const { return derivedTypes_; }
+    Range<ModelFormat::Variable> moduleVariables() const { return moduleVariables_; }
+
+    /// \return the subprogram, common block or module variable with \p linkageName, null if there is none.
+    const ModelFormat::Subprogram *findSubprogram(const char *linkageName) const;
+    const ModelFormat::CommonBlock *findCommonBlock(const char *linkageName) const;
+    const ModelFormat::Variable *findModuleVariable(const char *linkageName) const;
+
+    /// \return the derived type whose struct is named \p cName, as in Variable::derivedType, or null.
+    const ModelFormat::DerivedType *findDerivedType(const char *cName) const;
+
+    /// Arguments including the hidden string lengths, in order.
+    Range<ModelFormat::Variable> arguments(const ModelFormat::Subprogram &sub) const;
+    /// \return null if \p sub is a subroutine.
+    const ModelFormat::Variable *returnValue(const ModelFormat::Subprogram &sub) const;
+    Range<ModelFormat::Variable> members(const ModelFormat::CommonBlock &cb) const;
+    /// The members of \p type at their offsets, padding included.
+    Range<ModelFormat::Variable> members(const ModelFormat::DerivedType &type) const;
+    Range<ModelFormat::Dimension> dimensions(const ModelFormat::Variable &var) const;
+
+    /// \return the string at \p offset in the string table.
+    const char *string(uint32_t offset) const;
+
+    /// Writes the whole model as JSON.
+    void writeJSON(std::ostream &os) const;
+
+private:
+    void open(const char *data, size_t size);
+
+    template <typename T>
+    Range<T> table(const ModelFormat::Table &t) const;
+
+    template <typename T>
+    Range<T> slice(Range<T> all, uint32_t first, uint32_t count) const;
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    void *mapping_ = nullptr;
+    std::vector<char> contents_;
+
+    Range<ModelFormat::Subprogram> subprograms_;
+    Range<ModelFormat::Variable> variables_;
+    Range<ModelFormat::CommonBlock> commonBlocks_;
+    Range<ModelFormat::Dimension> dimensions_;
+    Range<ModelFormat::DerivedType> derivedTypes_;
+    Range<ModelFormat::Variable> moduleVariables_;
+    const char *strings_ = nullptr;
+    uint32_t stringsSize_ = 0;
+};
+
+#endif
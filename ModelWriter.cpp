@@ -0,0 +1,163 @@
+#include "ModelWriter.hpp"
+#include "DerivedType.hpp"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+
+uint32_t ModelWriter::addString(StringRef s)
+{
+    auto inserted = stringOffsets_.insert(std::make_pair(s.str(), uint32_t(strings_.size())));
+    if (inserted.second) {
+        strings_.append(s.data(), s.size());
+        strings_.push_back('\0');
+    }
+    return inserted.first->second;
+}
+
+/// Appends the record of \p var to \p variables and its dimensions to the dimensions.
+uint32_t ModelWriter::addVariable(const Variable &var, std::vector<ModelFormat::Variable> &variables)
+{
+    ModelFormat::Variable r;
+    std::memset(&r, 0, sizeof(r));
+    r.name = addString(var.name_);
+    r.context = var.context_;
+    r.isConst = var.isConst_;
+    r.descriptorRank = var.descriptorRank_;
+    r.isAllocatable = var.isAllocatable_;
+    r.type = var.type_;
+    r.firstDim = dimensions_.size();
+    r.dimCount = var.dims_.size();
+    r.derivedType = var.derived_ ? addString(var.derived_->cName()) : ModelFormat::none;
+    r.elementSize = var.elementSize_;
+    r.location = var.location_;
+    r.elementLength = var.elementLength_;
+    for (auto &d : var.dims_) {
+        ModelFormat::Dimension dim;
+        std::memset(&dim, 0, sizeof(dim));
+        if (d.hasValue()) {
+            dim.lower = d.getValue().first;
+            dim.upper = d.getValue().second;
+            dim.known = 1;
+        }
+        dimensions_.push_back(dim);
+    }
+    variables.push_back(r);
+    return variables.size() - 1;
+}
+
+void ModelWriter::add(const Subprogram &sub)
+{
+    ModelFormat::Subprogram r;
+    std::memset(&r, 0, sizeof(r));
+    r.name = addString(sub.name_);
+    r.linkageName = addString(sub.linkageName_);
+    r.firstArg = variables_.size();
+    r.argCount = sub.args_.size();
+    for (auto &arg : sub.args_) {
+        addVariable(*arg, variables_);
+    }
+    r.returnValue = sub.returnVal_ ? addVariable(*sub.returnVal_, variables_) : ModelFormat::none;
+    subprograms_.push_back(r);
+}
+
+void ModelWriter::add(const CommonBlock &cb)
+{
+    ModelFormat::CommonBlock r;
+    std::memset(&r, 0, sizeof(r));
+    r.name = addString(cb.name_);
+    r.linkageName = addString(cb.linkageName_);
+    r.firstVar = variables_.size();
+    r.varCount = cb.vars_.size();
+    r.address = cb.address_;
+    for (auto &v : cb.vars_) {
+        addVariable(*v, variables_);
+    }
+    commonBlocks_.push_back(r);
+}
+
+void ModelWriter::add(const DerivedType &type)
+{
+    ModelFormat::DerivedType r;
+    std::memset(&r, 0, sizeof(r));
+    r.name = addString(type.name_);
+    r.cName = addString(type.cName());
+    r.firstMember = variables_.size();
+    r.memberCount = type.members_.size();
+    r.byteSize = type.byteSize_;
+    for (auto &m : type.members_) {
+        addVariable(*m, variables_);
+    }
+    derivedTypes_.push_back(r);
+}
+
+void ModelWriter::addModuleVariable(const Variable &var)
+{
+    addVariable(var, moduleVariables_);
+}
+
+void ModelWriter::write(raw_ostream &os)
+{
+    const char *strings = strings_.c_str();
+    std::stable_sort(subprograms_.begin(), subprograms_.end(),
+                     [strings](const ModelFormat::Subprogram &a, const ModelFormat::Subprogram &b) {
+                         return std::strcmp(strings + a.linkageName, strings + b.linkageName) < 0;
+                     });
+    std::stable_sort(commonBlocks_.begin(), commonBlocks_.end(),
+                     [strings](const ModelFormat::CommonBlock &a, const ModelFormat::CommonBlock &b) {
+                         return std::strcmp(strings + a.linkageName, strings + b.linkageName) < 0;
+                     });
+    std::stable_sort(derivedTypes_.begin(), derivedTypes_.end(),
+                     [strings](const ModelFormat::DerivedType &a, const ModelFormat::DerivedType &b) {
+                         return std::strcmp(strings + a.cName, strings + b.cName) < 0;
+                     });
+    std::stable_sort(moduleVariables_.begin(), moduleVariables_.end(),
+                     [strings](const ModelFormat::Variable &a, const ModelFormat::Variable &b) {
+                         return std::strcmp(strings + a.name, strings + b.name) < 0;
+                     });
+    if (strings_.empty()) {
+        strings_.push_back('\0');
+    }
+
+    ModelFormat::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ModelFormat::magic, sizeof(header.magic));
+    header.version = ModelFormat::version;
+    header.byteOrder = ModelFormat::byteOrder;
+
+    // every table starts on an 8 byte boundary
+    uint64_t offset = sizeof(header);
+    auto place = [&offset](ModelFormat::Table &table, size_t count, size_t recordSize) {
+        offset = (offset + 7) & ~uint64_t(7);
+        table.offset = offset;
+        table.count = count;
+        table.recordSize = recordSize;
+        offset += count * recordSize;
+    };
+    place(header.subprograms, subprograms_.size(), sizeof(ModelFormat::Subprogram));
+    place(header.variables, variables_.size(), sizeof(ModelFormat::Variable));
+    place(header.commonBlocks, commonBlocks_.size(), sizeof(ModelFormat::CommonBlock));
+    place(header.dimensions, dimensions_.size(), sizeof(ModelFormat::Dimension));
+    place(header.derivedTypes, derivedTypes_.size(), sizeof(ModelFormat::DerivedType));
+    place(header.moduleVariables, moduleVariables_.size(), sizeof(ModelFormat::Variable));
+    place(header.strings, strings_.size(), 1);
+
+    uint64_t written = 0;
+    auto put = [&os, &written](const ModelFormat::Table &table, const void *data) {
+        for (; written < table.offset; ++written) {
+            os << '\0';
+        }
+        os.write(static_cast<const char *>(data), table.count * table.recordSize);
+        written += table.count * table.recordSize;
+    };
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    written = sizeof(header);
+    put(header.subprograms, subprograms_.data());
+    put(header.variables, variables_.data());
+    put(header.commonBlocks, commonBlocks_.data());
+    put(header.dimensions, dimensions_.data());
+    put(header.derivedTypes, derivedTypes_.data());
+    put(header.moduleVariables, moduleVariables_.data());
+    put(header.strings, strings_.data());
+}
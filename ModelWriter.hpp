@@ -0,0 +1,46 @@
+#ifndef ModelWriter_hpp
+#define ModelWriter_hpp
+
+#include <map>
+#include <string>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+#include "ModelFormat.hpp"
+#include "CommonBlock.hpp"
+#include "Subprogram.hpp"
+
+namespace llvm {
+class raw_ostream;
+}
+
+/**
+ * Flattens the declared subprograms, the common blocks, the derived types and
+ * the module variables into the tables of ModelFormat for --emit-model.
+ * ModelReader reads the result.
+ */
+class ModelWriter
+{
+public:
+    void add(const Subprogram &sub);
+    void add(const CommonBlock &cb);
+    void add(const DerivedType &type);
+    void addModuleVariable(const Variable &var);
+
+    /// Writes the model, the records are sorted first.
+    void write(llvm::raw_ostream &os);
+
+private:
+    uint32_t addString(llvm::StringRef s);
+    uint32_t addVariable(const Variable &var, std::vector<ModelFormat::Variable> &variables);
+
+    std::vector<ModelFormat::Subprogram> subprograms_;
+    std::vector<ModelFormat::Variable> variables_;
+    std::vector<ModelFormat::CommonBlock> commonBlocks_;
+    std::vector<ModelFormat::DerivedType> derivedTypes_;
+    std::vector<ModelFormat::Variable> moduleVariables_;
+    std::vector<ModelFormat::Dimension> dimensions_;
+    std::string strings_;
+    std::map<std::string, uint32_t> stringOffsets_;
+};
+
+#endif
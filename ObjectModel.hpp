@@ -0,0 +1,43 @@
+#ifndef ObjectModel_hpp
+#define ObjectModel_hpp
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Subprogram.hpp"
+#include "CommonBlock.hpp"
+#include "ModelArena.hpp"
+
+/**
+ * Subprograms, common blocks and module variables extracted from a single compile unit.
+ * Every extraction job fills only its own UnitModel and the models are
+ * emitted in input order so the output does not depend on the number of threads.
+ */
+struct UnitModel
+{
+    UnitModel() : isFortran(false), cacheable(true), arena(new ModelArena()) {}
+
+    /// false if the unit was skipped, in which case nothing is emitted for it
+    bool isFortran;
+    /**
+     * false if the model depends on more than the object it came from, as
+     * with a .dwo, which may be missing or rebuilt, so it must not be cached
+     */
+    bool cacheable;
+    std::string name;
+
+    /// owns the subprograms, common blocks, variables and names below
+    std::unique_ptr<ModelArena> arena;
+    std::vector<Subprogram::Handle> subprograms;
+    CommonBlock::CommonList commons;
+    /// variables of the modules defined in the unit, named by their symbols
+    std::vector<Variable::Handle> moduleVariables;
+};
+
+/// Everything extracted from one input file, one entry per compile unit.
+struct ObjectModel
+{
+    std::vector<UnitModel> units;
+};
+
+#endif
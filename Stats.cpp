@@ -0,0 +1,90 @@
+#include "Stats.hpp"
+#include "TimeTrace.hpp"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace {
+
+const char *counterNames[Stats::NumCounters] = {
+    "input files",
+    "object files",
+    "object files from the cache",
+    "compile units",
+    "compile units read through an index",
+    "object files without selected symbols",
+    "compile units without selected symbols",
+    "DIEs read",
+    "types resolved",
+    "types reused",
+    "subprograms emitted",
+    "subprograms skipped",
+    "common blocks in units",
+    "common blocks deduplicated",
+    "derived types emitted",
+    "module variables emitted",
+    "module variables skipped",
+    "bytes written"
+};
+
+const char *phaseNames[Stats::NumPhases] = {
+    "load",
+    "cache",
+    "context",
+    "unit",
+    "types",
+    "padding",
+    "emit"
+};
+
+}
+
+bool Stats::enabled_ = false;
+std::atomic<uint64_t> Stats::counters_[Stats::NumCounters];
+std::atomic<uint64_t> Stats::phaseTimes_[Stats::NumPhases];
+std::atomic<uint64_t> Stats::phaseCounts_[Stats::NumPhases];
+
+Stats::Timer::Timer(Phase phase, StringRef detail) : phase_(phase), detail_(detail)
+{
+    active_ = enabled_ || (phase_ <= Unit && TimeTrace::current());
+    if (active_) {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+Stats::Timer::~Timer()
+{
+    if (!active_) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (enabled_) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+        phaseTimes_[phase_].fetch_add(ns, std::memory_order_relaxed);
+        phaseCounts_[phase_].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (phase_ <= Unit) {
+        if (TimeTrace *trace = TimeTrace::current()) {
+            trace->record(phaseNames[phase_], detail_, start_, end);
+        }
+    }
+}
+
+void Stats::print(raw_ostream &os, double wallSeconds)
+{
+    os << "f2h statistics\n";
+    for (int i=0; i<NumCounters; ++i) {
+        os << format("  %-40s %12llu\n", counterNames[i],
+                     static_cast<unsigned long long>(counters_[i].load(std::memory_order_relaxed)));
+    }
+
+    // phases nest (types and padding are part of unit) and are summed over threads
+    os << "  phase                            seconds (all threads)       count\n";
+    for (int i=0; i<NumPhases; ++i) {
+        os << format("  %-32s %22.6f %11llu\n", phaseNames[i],
+                     phaseTimes_[i].load(std::memory_order_relaxed) * 1e-9,
+                     static_cast<unsigned long long>(phaseCounts_[i].load(std::memory_order_relaxed)));
+    }
+    os << "  wall time                        " << format("%22.6f\n", wallSeconds);
+}
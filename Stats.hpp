@@ -0,0 +1,94 @@
+#ifndef Stats_hpp
+#define Stats_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+class raw_ostream;
+}
+
+/**
+ * Counters and per-phase timers printed by --f2h-stats.
+ *
+ * Everything is updated with relaxed atomics from the extraction jobs and only
+ * read once the jobs are done.  Nothing is recorded unless enabled_ is set, so
+ * without --f2h-stats the cost is a test of a flag.
+ */
+class Stats
+{
+public:
+    enum Counter {
+        InputFiles,
+        ObjectFiles,
+        CachedObjects,
+        CompileUnits,
+        IndexedUnits,
+        SkippedObjects,
+        SkippedUnits,
+        DIEs,
+        TypesResolved,
+        TypesMemoized,
+        Subprograms,
+        SubprogramsSkipped,
+        CommonBlocks,
+        CommonBlocksDeduplicated,
+        DerivedTypes,
+        ModuleVariables,
+        ModuleVariablesSkipped,
+        BytesWritten,
+        NumCounters
+    };
+
+    /// Phases up to Unit are also recorded by --time-trace.
+    enum Phase {
+        Load,
+        Cache,
+        Context,
+        Unit,
+        Types,
+        Padding,
+        Emit,
+        NumPhases
+    };
+
+    static void add(Counter counter, uint64_t n = 1)
+    {
+        if (enabled_) {
+            counters_[counter].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Times the enclosing scope as \p phase.  The traced phases are also
+     * recorded in the time trace of the thread, if there is one, labelled
+     * with \p detail, which must outlive the timer.
+     */
+    class Timer
+    {
+    public:
+        explicit Timer(Phase phase, llvm::StringRef detail = llvm::StringRef());
+        ~Timer();
+
+    private:
+        Phase phase_;
+        llvm::StringRef detail_;
+        bool active_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    /// Writes the counters, the time spent in each phase and the total \p wallSeconds.
+    static void print(llvm::raw_ostream &os, double wallSeconds);
+
+    static bool enabled_;
+
+private:
+    static std::atomic<uint64_t> counters_[NumCounters];
+    /// nanoseconds, summed over all threads
+    static std::atomic<uint64_t> phaseTimes_[NumPhases];
+    static std::atomic<uint64_t> phaseCounts_[NumPhases];
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Subprogram.hpp"
+#include "ArrayDescriptor.hpp"
 #include "CommonBlock.hpp"
 #include "llvm/DebugInfo/DWARF/DWARFCompileUnit.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -8,48 +9,46 @@
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/BinaryFormat/Dwarf.h"
-#include <sstream>
+#include "llvm/ADT/SmallVector.h"
 
 using namespace llvm;
 
-Subprogram::Subprogram() : unsupported_(true)
+Subprogram::Subprogram() : returnVal_(nullptr), unsupported_(true)
 {
     
 }
 
-Subprogram::~Subprogram()
+Subprogram::Handle Subprogram::extract(Die die, CommonBlock::CommonList &commons, ModelArena &arena)
 {
-    
-}
+    Handle r = nullptr;
 
-Subprogram::Handle Subprogram::extract(llvm::DWARFDie die)
-{
-    Handle r(new Subprogram());
+    // ignore subprograms with an abstract origin as they just refer to a concrete instance
+    // which will be picked up later.  Checked before the names since those would be
+    // looked up through the origin.
+    auto abstractOrigin = die.find(dwarf::DW_AT_abstract_origin);
+    if (abstractOrigin.hasValue()) {
+        return r;
+    }
 
-    r->name_ = die.getName(DINameKind::ShortName);
-    r->linkageName_ = die.getName(DINameKind::LinkageName);
+    r = arena.make<Subprogram>();
+    r->name_ = arena.intern(die.getName(DINameKind::ShortName));
+    r->linkageName_ = arena.intern(die.getName(DINameKind::LinkageName));
 
     // ignore main
     if (!r->name_.compare("main")) {
         r->unsupported_ = true;
         return r;
     }
-    
-    // ignore subprograms with an abstract origin as they just refer to a concrete instance
-    // which will be picked up later
-    auto abstractOrigin = die.find(dwarf::DW_AT_abstract_origin);
-    if (abstractOrigin.hasValue()) {
-        r.reset();
-        return r;
-    }
         
+    SmallVector<Variable::Handle, 8> args;
     int stringParamCount = 0;
+    bool hasResult = false;
     auto child = die.getFirstChild();
     while (child.isValid() && !child.isNULL()) {
         auto tag = child.getTag();
         if (tag == dwarf::DW_TAG_common_block) {
             try {
-                CommonBlock::extractAndAdd(child);
+                CommonBlock::extractAndAdd(child, commons, arena);
             } catch (std::runtime_error &ex) {
                 errs() << "skipping common block in " << r->name_  << " because " << ex.what() << "\n";
             }
@@ -57,22 +56,31 @@ Subprogram::Handle Subprogram::extract(llvm::DWARFDie die)
         
         else if (tag == dwarf::DW_TAG_formal_parameter) {
             try {
-                Variable::Handle h = Variable::extract(Variable::PARAMETER, child);
-                
-                // if there is a parameter named __result, then it is an out parameter for
-                // the return value of a function.  I still haven't figured out how this works
-                // so best to skip this function
-                if (!h->name_.compare("__result")) {
-                    errs() << "function " << r->name_ << " appears to return an array or string which is not supported yet, skipping...\n";
-                    break;
+                // A function returning a string or an array has a __result parameter
+                // ahead of the others that it writes the result to, a character buffer
+                // or the descriptor of the array.  For a string its length follows in
+                // .__result instead of at the end.
+                StringRef paramName = child.getName(DINameKind::ShortName);
+                Variable::Context context = Variable::PARAMETER;
+                if (paramName == "__result") {
+                    context = Variable::RESULT;
+                } else if (paramName == ".__result") {
+                    context = Variable::RESULT_LEN_PARAMETER;
+                }
+                Variable::Handle h = Variable::extract(context, child, arena);
+                if (context == Variable::RESULT) {
+                    h->name_ = arena.intern("f2h_result");
+                    hasResult = true;
+                } else if (context == Variable::RESULT_LEN_PARAMETER) {
+                    h->name_ = arena.intern("f2h_result_len");
                 }
                 
                 // if this argument is a string, then there will be a hidden argument at the end for its length
-                if (h->isString()) {
+                if (context == Variable::PARAMETER && h->isString()) {
                     ++stringParamCount;
                 }
                 
-                r->args_.push_back(std::move(h));
+                args.push_back(h);
                 
 
             } catch (std::runtime_error &ex) {
@@ -84,75 +92,227 @@ Subprogram::Handle Subprogram::extract(llvm::DWARFDie die)
         // need to check the local variables because that is the only way to identify
         // a function that returns a value
         else if (tag == dwarf::DW_TAG_variable) {
-            r->extractReturn(child);
+            r->extractReturn(child, arena);
         }
         
         child = child.getSibling();
     }
     
     // mark parameters at the end of the argument list as string lengths
-    auto rit = r->args_.rbegin();
+    auto rit = args.rbegin();
     while (stringParamCount > 0) {
-        rit->get()->context_ = Variable::STRING_LEN_PARAMETER;
+        (*rit)->context_ = Variable::STRING_LEN_PARAMETER;
         --stringParamCount;
         ++rit;
     }
+    r->args_ = arena.copy<Variable::Handle>(args);
+    
+    // the result variable is only a view of __result
+    if (hasResult) {
+        r->returnVal_ = nullptr;
+    }
     
     r->unsupported_ = false;
     return r;
 }
 
-std::string Subprogram::cDeclaration() const
+void Subprogram::cDeclaration(llvm::raw_ostream &os, bool declareExtents) const
 {
-    std::stringstream ss;
+    if (unsupported_) {
+        os << "// function " << name_ << " is not supported yet\n";
+        return;
+    }
+
+    // nothing is written unless the whole declaration can be
+    if (returnVal_) {
+        llvm::raw_null_ostream null;
+        returnVal_->cType(null);
+    }
+    for (auto &arg : args_) {
+        try {
+            arg->checkDeclaration();
+        } catch (std::runtime_error &ex) {
+            errs() << "Subprogram::cDeclaration--argument cDecl failed: " << ex.what() << "\n";
+            errs() << "Skipping " << name_ << "\n";
+            throw ex;
+        }
+    }
+
+    // lines are wrapped relative to the start of the declaration
+    uint64_t start = os.tell();
     int line = 1;
 
-    if (unsupported_) {
-        ss << "// function " << name_ << " is not supported yet\n";
+    // return type
+    if (returnVal_) {
+        returnVal_->cType(os);
+        os << " ";
     } else {
-        
-        // return type
-        if (returnVal_) {
-            ss << returnVal_->cType() << " ";
-        } else {
-            ss << "void ";
-        }
-        
-        // name
-        ss << linkageName_ << "( ";
-        
-        // arguments
-        size_t narg = args_.size();
-        for (size_t i=0; i<narg; ++i) {
-            auto &arg = args_[i];
-            if (i>0) {
-                ss << ", ";
-                
-                if (ss.tellp() > line * 100) {
-                    ss << std::endl << "    ";
-                    ++line;
-                }
-            }
-            try {
-                ss << arg->cDeclaration();
-            } catch (std::runtime_error &ex) {
-                errs() << "Subprogram::cDeclaration--argument cDecl failed: " << ex.what() << "\n";
-                errs() << "Skipping " << name_ << "\n";
-                throw ex;
+        os << "void ";
+    }
+    
+    // name
+    os << linkageName_ << "( ";
+    
+    // arguments
+    size_t narg = args_.size();
+    for (size_t i=0; i<narg; ++i) {
+        if (i>0) {
+            os << ", ";
+            
+            if (os.tell() - start > uint64_t(line * 100)) {
+                os << "\n    ";
+                ++line;
             }
         }
-        
-        ss << " );";
+        args_[i]->cDeclaration(os, declareExtents);
+    }
+    
+    os << " );";
+}
+
+void Subprogram::cxxViews(llvm::raw_ostream &os) const
+{
+    bool any = false;
+    for (auto &arg : args_) {
+        // the length of a string argument is passed separately
+        if (arg->dims_.empty() || arg->isString()) {
+            continue;
+        }
+        if (!any) {
+            os << "namespace " << linkageName_ << " {\n";
+            any = true;
+        }
+        os << "using " << arg->name_ << " = ";
+        arg->cxxViewType(os);
+        os << ";\n";
+    }
+    if (any) {
+        os << "}\n";
+    }
+}
+
+void Subprogram::cxxStringOverload(llvm::raw_ostream &os, bool declareExtents) const
+{
+    for (auto &arg : args_) {
+        if (arg->context_ == Variable::PARAMETER && arg->isString()) {
+            cxxOverload(os, declareExtents, true, false);
+            return;
+        }
+    }
+}
+
+void Subprogram::cxxResultOverload(llvm::raw_ostream &os, bool declareExtents, bool charArgs) const
+{
+    for (auto &arg : args_) {
+        // an array result without a descriptor has no f2h_array_r<rank> to build
+        if (arg->context_ == Variable::RESULT && !arg->isAllocatable_ && (arg->isString() || arg->descriptorRank_)) {
+            cxxOverload(os, declareExtents, charArgs, true);
+            return;
+        }
     }
+}
+
+/**
+ * Arguments that aren't replaced are declared and passed as in the C
+ * prototype, so a string overload still takes the raw result buffer and a
+ * result overload without \p charArgs still takes the string lengths.
+ */
+void Subprogram::cxxOverload(llvm::raw_ostream &os, bool declareExtents, bool charArgs, bool results) const
+{
+    auto replaced = [&](const Variable &arg) {
+        switch (arg.context_) {
+            case Variable::PARAMETER:
+                return charArgs && arg.isString();
+            case Variable::STRING_LEN_PARAMETER:
+                return charArgs;
+            case Variable::RESULT:
+            case Variable::RESULT_LEN_PARAMETER:
+                return results;
+            default:
+                return false;
+        }
+    };
 
-    return ss.str();
+    os << "inline ";
+    if (returnVal_) {
+        returnVal_->cType(os);
+        os << " ";
+    } else {
+        os << "void ";
+    }
+    os << linkageName_ << "( ";
+    bool first = true;
+    Variable::Handle result = nullptr;
+    SmallVector<Variable::Handle, 8> strings;
+    for (auto &arg : args_) {
+        if (replaced(*arg) && (arg->context_ == Variable::STRING_LEN_PARAMETER ||
+                               arg->context_ == Variable::RESULT_LEN_PARAMETER)) {
+            continue;
+        }
+        os << (first ? "" : ", ");
+        first = false;
+        if (!replaced(*arg)) {
+            arg->cDeclaration(os, declareExtents);
+        } else if (arg->context_ == Variable::PARAMETER) {
+            os << "f2h::char_arg " << arg->name_;
+            strings.push_back(arg);
+        } else if (arg->isString()) {
+            os << "std::string &" << arg->name_;
+            result = arg;
+        } else {
+            // the caller's buffer, the extents are what the function expects
+            arg->cElementType(os);
+            os << " *" << arg->name_ << ", const std::ptrdiff_t (&f2h_extent)[" << arg->descriptorRank_ << "]";
+            result = arg;
+        }
+    }
+    os << " ) {\n";
+
+    // a string of the right length is reused, only a fixed length is known here
+    if (result && result->isString() && result->elementSize() != static_cast<size_t>(-1)) {
+        os << "    " << result->name_ << ".resize(" << result->elementSize() << ");\n";
+    } else if (result && !result->isString()) {
+        os << "    ";
+        ArrayDescriptor::writeName(os, result->descriptorRank_);
+        os << " f2h_d = ";
+        ArrayDescriptor::writeName(os, result->descriptorRank_);
+        os << "_of(" << result->name_ << ", sizeof(";
+        result->cElementType(os);
+        os << "), " << ArrayDescriptor::typeCode(result->type_, result->derived_) << ", f2h_extent, nullptr);\n";
+    }
+    os << "    " << (returnVal_ ? "return " : "") << "::" << linkageName_ << "( ";
+
+    // the lengths follow the other arguments in the order of the strings
+    first = true;
+    for (auto &arg : args_) {
+        if (replaced(*arg) && arg->context_ == Variable::STRING_LEN_PARAMETER) {
+            continue;
+        }
+        os << (first ? "" : ", ");
+        first = false;
+        if (!replaced(*arg)) {
+            os << arg->name_;
+        } else if (arg->context_ == Variable::PARAMETER) {
+            os << arg->name_ << ".data";
+        } else if (arg->context_ == Variable::RESULT_LEN_PARAMETER) {
+            os << result->name_ << ".size()";
+        } else if (arg->isString()) {
+            os << "&" << arg->name_ << "[0]";
+        } else {
+            os << "&f2h_d";
+        }
+    }
+    for (auto &s : strings) {
+        os << ", " << s->name_ << ".size";
+    }
+    os << " );\n}\n";
 }
 
-void Subprogram::extractReturn(llvm::DWARFDie die)
+void Subprogram::extractReturn(Die die, ModelArena &arena)
 {
-    std::string resultName = "__result_" + name_;
+    std::string resultName = "__result_" + name_.str();
     const char *varName = die.getName(DINameKind::ShortName);
     if (varName && !resultName.compare(varName)) {
-        returnVal_ = Variable::extract(Variable::PARAMETER, die);
+        returnVal_ = Variable::extract(Variable::PARAMETER, die, arena);
     }
 }
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <memory>
 #include "Variable.hpp"
+#include "CommonBlock.hpp"
 
 namespace llvm {
 class DWARFDebugInfoEntryMinimal;
@@ -16,26 +17,61 @@ class DWARFCompileUnit;
 class Subprogram
 {
 public:
-    using Handle = std::unique_ptr<Subprogram>;
+    using Handle = Subprogram *;
     
     Subprogram();
-    ~Subprogram();
     
     /**
      * Extract information about the subprogram from dwarf data.
-     * Any referenced common blocks are added to the static map.
+     * Any referenced common blocks are added to \p commons.
+     * The subprogram, its arguments and the common blocks are allocated in \p arena.
      */
-    static Handle extract(llvm::DWARFDie die);
+    static Handle extract(Die die, CommonBlock::CommonList &commons, ModelArena &arena);
 
-    std::string cDeclaration() const;
+    /**
+     * Writes the C prototype to \p os.  Throws before writing anything if
+     * the return value or an argument has no C declaration.  \p declareExtents
+     * is passed on to the arguments, see Variable::cDeclaration.
+     */
+    void cDeclaration(llvm::raw_ostream &os, bool declareExtents = false) const;
+    
+    /**
+     * Writes a namespace named after the subprogram with a fortran_array type
+     * for each array argument, nothing if there are none.
+     */
+    void cxxViews(llvm::raw_ostream &os) const;
+    
+    /**
+     * Writes an inline C++ overload taking an f2h::char_arg for each CHARACTER
+     * argument and passing its length as the hidden argument, nothing if
+     * there are no CHARACTER arguments.
+     */
+    void cxxStringOverload(llvm::raw_ostream &os, bool declareExtents = false) const;
+    
+    /**
+     * Writes an inline C++ overload of a function returning a string or an
+     * array that writes the result to a buffer of the caller, nothing for
+     * other subprograms, an ALLOCATABLE or POINTER result or an array result
+     * without a descriptor.  A string result
+     * is a std::string, resized to the length of the result if that is fixed
+     * and otherwise passed with its size.  An array result is the address of
+     * the elements and the extents, described by a descriptor on the stack.
+     * Reusing the same buffer across calls allocates nothing.  CHARACTER
+     * arguments are f2h::char_arg if \p charArgs is set.
+     */
+    void cxxResultOverload(llvm::raw_ostream &os, bool declareExtents, bool charArgs) const;
     
-    std::string name_;
-    std::string linkageName_;
-    std::vector<Variable::Handle> args_;
+    llvm::StringRef name_;
+    llvm::StringRef linkageName_;
+    llvm::ArrayRef<Variable::Handle> args_;
     Variable::Handle returnVal_;
     bool unsupported_;
     
-    void extractReturn(llvm::DWARFDie die);
+    void extractReturn(Die die, ModelArena &arena);
+
+private:
+    /// Writes the overload replacing CHARACTER arguments if \p charArgs is set and the result if \p results is.
+    void cxxOverload(llvm::raw_ostream &os, bool declareExtents, bool charArgs, bool results) const;
 };
 
 #endif
@@ -0,0 +1,119 @@
+#include "SymbolSelector.hpp"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <stdexcept>
+
+using namespace llvm;
+using namespace object;
+
+SymbolSelector::SymbolSelector(const std::vector<std::string> &patterns, bool exportedOnly)
+: exportedOnly_(exportedOnly)
+{
+    std::string regexText;
+    for (auto &pattern : patterns) {
+        StringRef p(pattern);
+        if (p.size() > 1 && p.startswith("/") && p.endswith("/")) {
+            std::unique_ptr<Regex> regex(new Regex(p.drop_front().drop_back()));
+            std::string err;
+            if (!regex->isValid(err)) {
+                throw std::runtime_error("bad symbol regex " + pattern + ": " + err);
+            }
+            regexes_.push_back(std::move(regex));
+            regexText += pattern + "\n";
+        } else if (p.startswith("@")) {
+            auto BuffOrErr = MemoryBuffer::getFile(p.drop_front());
+            if (!BuffOrErr) {
+                throw std::runtime_error("failed to read symbol list " + p.drop_front().str() + ": " +
+                                         BuffOrErr.getError().message());
+            }
+            SmallVector<StringRef, 64> lines;
+            BuffOrErr.get()->getBuffer().split(lines, '\n', -1, false);
+            for (auto line : lines) {
+                line = line.trim();
+                if (!line.empty()) {
+                    names_.insert(line.str());
+                }
+            }
+        } else if (!p.empty()) {
+            names_.insert(pattern);
+        }
+    }
+
+    fingerprint_ = exportedOnly_ ? "exported\n" : "all\n";
+    fingerprint_ += regexText;
+    for (auto &name : names_) {
+        fingerprint_ += name + "\n";
+    }
+}
+
+bool SymbolSelector::matches(StringRef name) const
+{
+    if (names_.count(name.str())) {
+        return true;
+    }
+    for (auto &regex : regexes_) {
+        if (regex->match(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SymbolSelector::Selection SymbolSelector::select(const ObjectFile &object) const
+{
+    Selection r;
+    bool filtered = !names_.empty() || !regexes_.empty();
+
+    auto consider = [&](const SymbolRef &sym) {
+        uint32_t flags = sym.getFlags();
+        if ((flags & SymbolRef::SF_Undefined) || (exportedOnly_ && !(flags & SymbolRef::SF_Global))) {
+            return;
+        }
+        auto TypeOrErr = sym.getType();
+        if (!TypeOrErr) {
+            consumeError(TypeOrErr.takeError());
+            return;
+        }
+        if (TypeOrErr.get() != SymbolRef::ST_Function) {
+            return;
+        }
+        auto NameOrErr = sym.getName();
+        if (!NameOrErr) {
+            consumeError(NameOrErr.takeError());
+            return;
+        }
+        StringRef name = NameOrErr.get();
+        // Mach-O prefixes C names with an underscore that the debug info doesn't have
+        if (object.isMachO()) {
+            name.consume_front("_");
+        }
+        if (filtered && !matches(name)) {
+            return;
+        }
+        auto AddrOrErr = sym.getAddress();
+        if (!AddrOrErr) {
+            consumeError(AddrOrErr.takeError());
+            return;
+        }
+        r[name.str()] = AddrOrErr.get();
+    };
+
+    // the dynamic symbols are the exported interface of a shared library,
+    // anything else only has its regular symbol table
+    auto *elf = dyn_cast<ELFObjectFileBase>(&object);
+    if (exportedOnly_ && elf) {
+        auto dynamic = elf->getDynamicSymbolIterators();
+        if (dynamic.begin() != dynamic.end()) {
+            for (const SymbolRef &sym : dynamic) {
+                consider(sym);
+            }
+            return r;
+        }
+    }
+    for (const SymbolRef &sym : object.symbols()) {
+        consider(sym);
+    }
+    return r;
+}
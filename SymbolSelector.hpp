@@ -0,0 +1,56 @@
+#ifndef SymbolSelector_hpp
+#define SymbolSelector_hpp
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Regex.h"
+
+namespace llvm {
+namespace object {
+class ObjectFile;
+}
+}
+
+/**
+ * Chooses the subprograms to declare for --symbols and --exported-only.
+ *
+ * The choice is made from the symbol table of each object before any debug
+ * info is read: the dynamic symbols of a shared library, or the global
+ * symbols of anything else, for --exported-only, and all defined functions
+ * otherwise.  Objects without a selected symbol are not extracted at all, the
+ * addresses of the selected symbols pick the compile units to extract through
+ * .debug_aranges, and only the selected subprograms of those units are kept.
+ */
+class SymbolSelector
+{
+public:
+    /// Function symbols chosen in one object, keyed by linkage name.
+    using Selection = std::map<std::string, uint64_t>;
+
+    /**
+     * Each of \p patterns is a symbol name, /regex/ or @file with one name per line.
+     * Throws std::runtime_error if a regex is malformed or a file can't be read.
+     */
+    SymbolSelector(const std::vector<std::string> &patterns, bool exportedOnly);
+
+    /// \return the selected function symbols defined in \p object.
+    Selection select(const llvm::object::ObjectFile &object) const;
+
+    /// \return true if \p name was given or matches one of the regexes.
+    bool matches(llvm::StringRef name) const;
+
+    /// Identifies the selection, the model of an object depends on it.
+    const std::string &fingerprint() const { return fingerprint_; }
+
+private:
+    std::set<std::string> names_;
+    std::vector<std::unique_ptr<llvm::Regex> > regexes_;
+    bool exportedOnly_;
+    std::string fingerprint_;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "TimeTrace.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+
+using namespace llvm;
+
+namespace {
+
+/// Trace timestamps are relative to this
+const TimeTrace::Clock::time_point epoch = TimeTrace::Clock::now();
+
+thread_local TimeTrace *boundTrace = nullptr;
+
+/// Small thread ids make the trace viewer's thread names readable
+unsigned threadId()
+{
+    static std::atomic<unsigned> next(0);
+    thread_local unsigned id = next++;
+    return id;
+}
+
+uint64_t microseconds(TimeTrace::Clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void writeJSONString(raw_ostream &os, StringRef s)
+{
+    os << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':
+                os << "\\\"";
+                break;
+
+            case '\\':
+                os << "\\\\";
+                break;
+
+            case '\n':
+                os << "\\n";
+                break;
+
+            case '\t':
+                os << "\\t";
+                break;
+
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    os << format("\\u%04x", c);
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+}
+
+TimeTrace::TimeTrace(std::string path) : path_(std::move(path))
+{
+}
+
+void TimeTrace::record(StringRef name, StringRef detail, Clock::time_point start, Clock::time_point end)
+{
+    Event e;
+    e.name = name.str();
+    e.detail = detail.str();
+    e.start = microseconds(start - epoch);
+    e.duration = microseconds(end - start);
+    e.thread = threadId();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back(std::move(e));
+}
+
+void TimeTrace::write() const
+{
+    std::error_code ec;
+    raw_fd_ostream os(path_, ec, sys::fs::F_None);
+    if (ec) {
+        errs() << "failed to write time trace " << path_ << ": " << ec.message() << '\n';
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    os << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto &e : events_) {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        os << "{\"pid\":1,\"tid\":" << e.thread << ",\"ph\":\"X\",\"ts\":" << e.start
+           << ",\"dur\":" << e.duration << ",\"name\":";
+        writeJSONString(os, e.name);
+        os << ",\"args\":{\"detail\":";
+        writeJSONString(os, e.detail);
+        os << "}}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+TimeTrace *TimeTrace::current()
+{
+    return boundTrace;
+}
+
+TimeTrace::Bind::Bind(TimeTrace *trace) : previous_(boundTrace)
+{
+    boundTrace = trace;
+}
+
+TimeTrace::Bind::~Bind()
+{
+    boundTrace = previous_;
+}
@@ -0,0 +1,62 @@
+#ifndef TimeTrace_hpp
+#define TimeTrace_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+
+/**
+ * Trace of the work done for one input file, written by --time-trace in the
+ * Chrome trace event format so it can be loaded into chrome://tracing or
+ * Perfetto.
+ *
+ * The jobs working on an input bind its trace to their thread, and the
+ * Stats::Timer scopes they run record into whichever trace is bound.
+ */
+class TimeTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// The trace will be written to \p path.
+    explicit TimeTrace(std::string path);
+
+    /// Records a complete event on the calling thread.  Thread safe.
+    void record(llvm::StringRef name, llvm::StringRef detail, Clock::time_point start, Clock::time_point end);
+
+    /// Writes the trace.  Failures are reported but not fatal.
+    void write() const;
+
+    /// \return the trace bound to the calling thread, null if none.
+    static TimeTrace *current();
+
+    /// Binds a trace to the calling thread for the lifetime of the object.
+    class Bind
+    {
+    public:
+        explicit Bind(TimeTrace *trace);
+        ~Bind();
+
+    private:
+        TimeTrace *previous_;
+    };
+
+private:
+    struct Event
+    {
+        std::string name;
+        std::string detail;
+        uint64_t start;     ///< microseconds since f2h started
+        uint64_t duration;  ///< microseconds
+        unsigned thread;
+    };
+
+    std::string path_;
+    mutable std::mutex mutex_;
+    std::vector<Event> events_;
+};
+
+#endif
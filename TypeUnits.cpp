@@ -0,0 +1,74 @@
+#include "TypeUnits.hpp"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFTypeUnit.h"
+#include "llvm/DebugInfo/DWARF/DWARFUnit.h"
+
+using namespace llvm;
+
+const Variable::Type *TypeUnits::Cache::find(uint64_t signature) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = types_.find(signature);
+    return it == types_.end() ? nullptr : it->second;
+}
+
+const Variable::Type *TypeUnits::Cache::insert(uint64_t signature, const Variable::Type &type)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto inserted = types_.insert(std::make_pair(signature, nullptr));
+    if (inserted.second) {
+        Variable::Type copy = type;
+        copy.dims = arena_.copy(type.dims);
+        inserted.first->second = arena_.make<Variable::Type>(copy);
+    }
+    return inserted.first->second;
+}
+
+TypeUnits::TypeUnits(DWARFContext &context, bool dwo, Cache &cache) : cache_(cache)
+{
+    // DWARF 4, .debug_types
+    for (const auto &section : dwo ? context.dwo_type_unit_sections() : context.type_unit_sections()) {
+        for (const auto &tu : section) {
+            add(*tu, tu->getTypeHash(), tu->getOffset() + tu->getTypeOffset());
+        }
+    }
+
+    // DWARF 5 type units are in .debug_info with a header of
+    // unit_length, version, unit_type, address_size, debug_abbrev_offset,
+    // type_signature and type_offset
+    for (const auto &cu : dwo ? context.dwo_compile_units() : context.compile_units()) {
+        if (!isTypeUnit(*cu)) {
+            continue;
+        }
+        auto data = cu->getDebugInfoExtractor();
+        uint32_t offset = cu->getOffset();
+        bool dwarf64 = data.getU32(&offset) == 0xffffffff;
+        offset = cu->getOffset() + (dwarf64 ? 24 : 12);
+        uint64_t signature = data.getU64(&offset);
+        uint64_t typeOffset = dwarf64 ? data.getU64(&offset) : data.getU32(&offset);
+        add(*cu, signature, cu->getOffset() + typeOffset);
+    }
+}
+
+void TypeUnits::add(DWARFUnit &unit, uint64_t signature, uint64_t typeOffset)
+{
+    // reads the bases of the string offsets and addresses the type's DIEs may need
+    unit.getUnitDIE(true);
+    units_.insert(std::make_pair(signature, std::make_pair(&unit, Die::Offset(typeOffset))));
+}
+
+Die TypeUnits::typeDie(uint64_t signature) const
+{
+    auto it = units_.find(signature);
+    if (it == units_.end()) {
+        return Die();
+    }
+    return Die::atOffset(*it->second.first, it->second.second);
+}
+
+bool TypeUnits::isTypeUnit(const DWARFUnit &unit)
+{
+    return unit.getVersion() >= 5 &&
+        (unit.getUnitType() == dwarf::DW_UT_type || unit.getUnitType() == dwarf::DW_UT_split_type);
+}
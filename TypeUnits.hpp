@@ -0,0 +1,70 @@
+#ifndef TypeUnits_hpp
+#define TypeUnits_hpp
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include "llvm/ADT/DenseMap.h"
+#include "Die.hpp"
+#include "ModelArena.hpp"
+#include "Variable.hpp"
+
+namespace llvm {
+class DWARFContext;
+class DWARFUnit;
+}
+
+/**
+ * The type units of one object, found by their signature when a DIE refers
+ * to a type with DW_FORM_ref_sig8.
+ *
+ * -fdebug-types-section moves shared types into type units, in .debug_types
+ * with DWARF 4 and in .debug_info with a unit type of DW_UT_type with DWARF 5.
+ * Every object carries a copy of the type units it uses, so the types they
+ * hold are resolved once per signature in a Cache shared by all the objects
+ * of a Generator.
+ */
+class TypeUnits
+{
+public:
+    /// Types resolved from type units, by signature.  Thread safe.
+    class Cache
+    {
+    public:
+        /// \return null if \p signature wasn't resolved yet.
+        const Variable::Type *find(uint64_t signature) const;
+
+        /**
+         * Keeps a copy of \p type for \p signature.
+         * \return the copy, or the type kept by whoever got there first.
+         */
+        const Variable::Type *insert(uint64_t signature, const Variable::Type &type);
+
+    private:
+        mutable std::mutex mutex_;
+        ModelArena arena_;
+        std::unordered_map<uint64_t, const Variable::Type *> types_;
+    };
+
+    /// Indexes the type units of \p context, the split ones if \p dwo is set.
+    TypeUnits(llvm::DWARFContext &context, bool dwo, Cache &cache);
+
+    bool empty() const { return units_.empty(); }
+
+    /// \return the type DIE of the type unit with \p signature, invalid if there is none.
+    Die typeDie(uint64_t signature) const;
+
+    Cache &cache() const { return cache_; }
+
+    /// \return true if \p unit is a DWARF 5 type unit in .debug_info, which has no compile unit DIE.
+    static bool isTypeUnit(const llvm::DWARFUnit &unit);
+
+private:
+    void add(llvm::DWARFUnit &unit, uint64_t signature, uint64_t typeOffset);
+
+    /// signature to the unit and the offset of its type DIE
+    llvm::DenseMap<uint64_t, std::pair<llvm::DWARFUnit *, Die::Offset> > units_;
+    Cache &cache_;
+};
+
+#endif
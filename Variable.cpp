@@ -1,8 +1,13 @@
 #include "Variable.hpp"
+#include "ArrayDescriptor.hpp"
+#include "DerivedType.hpp"
+#include "Stats.hpp"
+#include "TypeUnits.hpp"
 #include <llvm/DebugInfo/DWARF/DWARFContext.h>
 #include <llvm/DebugInfo/DWARF/DWARFFormValue.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/LEB128.h>
 #include <type_traits>
-#include <sstream>
 
 llvm::raw_ostream &operator<<(llvm::raw_ostream &o, const Variable &var)
 {
@@ -86,40 +91,50 @@ extractBaseType(llvm::DWARFDie dieType,
     return ret;
 }
 
-Variable::Variable() : isConst_(false)
+Variable::Variable() : location_(0), isConst_(false), derived_(nullptr), descriptorRank_(0),
+    elementLength_(0), isAllocatable_(false)
 {
     
 }
 
-Variable::~Variable()
-{
-    
-}
-
-std::unique_ptr<Variable>
-Variable::extract(Context context, llvm::DWARFDie die)
+Variable::Handle
+Variable::extract(Context context, Die die, ModelArena &arena)
 {
     using namespace llvm;
 
-    std::unique_ptr<Variable> r(new Variable());
+    Handle r = arena.make<Variable>();
     r->context_ = context;
-    r->name_ = die.getName(DINameKind::ShortName);
-    
-    // location is only used for common block members to determine padding
-    if (context == COMMON_BLOCK_MEMBER) {
-        r->extractLocation(die);
-    }
+    r->name_ = arena.intern(die.getName(DINameKind::ShortName));
     
     // type information
-    r->extractType(die);
+    r->extractType(die, arena);
 
     return r;
 }
 
-std::string Variable::dwarfToCType(llvm::dwarf::TypeKind type, size_t elementSize)
+void Variable::cType(llvm::raw_ostream &o) const
+{
+    if (descriptorRank_) {
+        ArrayDescriptor::writeName(o, descriptorRank_);
+    } else if (derived_) {
+        o << "struct " << derived_->cName();
+    } else {
+        dwarfToCType(o, type_, elementSize());
+    }
+}
+
+void Variable::cElementType(llvm::raw_ostream &o) const
+{
+    if (derived_) {
+        o << "struct " << derived_->cName();
+    } else {
+        dwarfToCType(o, type_, descriptorRank_ ? elementLength_ : elementSize());
+    }
+}
+
+void Variable::dwarfToCType(llvm::raw_ostream &o, llvm::dwarf::TypeKind type, size_t elementSize)
 {
     using namespace llvm;
-    std::ostringstream o;
     
     // element type declaration
     switch (type) {
@@ -182,18 +197,101 @@ std::string Variable::dwarfToCType(llvm::dwarf::TypeKind type, size_t elementSiz
         default:
             throw std::invalid_argument("unknown type");
     }
-    return o.str();
 }
 
-std::string Variable::cDeclaration() const
+void Variable::dwarfToNumpyType(llvm::raw_ostream &o, llvm::dwarf::TypeKind type, size_t elementSize)
+{
+    using namespace llvm;
+    
+    switch (type) {
+        case dwarf::DW_ATE_boolean:
+        case dwarf::DW_ATE_signed:
+            o << "i" << elementSize;
+            break;
+            
+        case dwarf::DW_ATE_unsigned:
+            o << "u" << elementSize;
+            break;
+            
+        case dwarf::DW_ATE_float:
+            // long double is padded to 16 bytes, only NumPy knows its real format
+            if (elementSize == 16) {
+                o << "g";
+            } else if (elementSize == 4 || elementSize == 8) {
+                o << "f" << elementSize;
+            } else {
+                throw std::invalid_argument("impossible float size");
+            }
+            break;
+            
+        case dwarf::DW_ATE_complex_float:
+            if (elementSize == 32) {
+                o << "G";
+            } else if (elementSize == 8 || elementSize == 16) {
+                o << "c" << elementSize;
+            } else {
+                throw std::invalid_argument("impossible complex size");
+            }
+            break;
+            
+        case dwarf::DW_ATE_signed_char:
+        case dwarf::DW_ATE_unsigned_char:
+            o << "S" << elementSize;
+            break;
+            
+        default:
+            throw std::invalid_argument("unknown type");
+    }
+}
+
+void Variable::numpyFormat(llvm::raw_ostream &o) const
+{
+    if (descriptorRank_) {
+        throw std::runtime_error("Variable::numpyFormat--array descriptors have no NumPy equivalent");
+    }
+    
+    auto element = [this](llvm::raw_ostream &o) {
+        if (derived_) {
+            derived_->numpyDtype(o);
+        } else {
+            o << "'";
+            dwarfToNumpyType(o, type_, elementSize_);
+            o << "'";
+        }
+    };
+    
+    if (dims_.empty()) {
+        element(o);
+        return;
+    }
+    
+    o << "(";
+    element(o);
+    o << ", (";
+    auto itdim = dims_.rbegin();
+    while (itdim != dims_.rend()) {
+        if (!itdim->hasValue()) {
+            throw std::runtime_error("Variable::numpyFormat--array with unspecified dimensions");
+        }
+        auto &d = itdim->getValue();
+        o << d.second - d.first + 1 << (dims_.size() == 1 ? "," : "");
+        if (++itdim != dims_.rend()) {
+            o << ", ";
+        }
+    }
+    o << "))";
+}
+
+void Variable::cDeclaration(llvm::raw_ostream &o, bool declareExtents) const
 {
     using namespace llvm;
-    std::ostringstream o;
     
     switch (context_) {
     
         case STRING_LEN_PARAMETER:
-            o << cType() << " " << name_;
+        case RESULT_LEN_PARAMETER:
+            cType(o);
+            o << " " << name_;
             break;
     
     /**
@@ -202,18 +300,27 @@ std::string Variable::cDeclaration() const
      * dimensions there are.  Maybe generate a comment?
      */
         case PARAMETER:
-            o << cType() << " *" << name_;
+        case RESULT:
+            cType(o);
+            if (declareExtents) {
+                cArrayParameter(o);
+            } else {
+                o << " *" << name_;
+            }
             break;
     
         case COMMON_BLOCK_MEMBER:
-            o << cType() << " " << name_;
+        case STRUCTURE_MEMBER:
+        case MODULE_VARIABLE:
+            cType(o);
+            o << " " << name_;
             
             // dimensions
             // array dimensions
             auto itdim = dims_.rbegin();
             while (itdim != dims_.rend()) {
                 if (!itdim->hasValue()) {
-                    throw std::runtime_error("Variable::cDeclaration--array in common block with unspecified dimensions");
+                    throw std::runtime_error("Variable::cDeclaration--array with unspecified dimensions outside an argument list");
                 } else {
                     auto &d = itdim->getValue();
                     o << "[" << d.second - d.first + 1 << "]";
@@ -227,10 +334,73 @@ std::string Variable::cDeclaration() const
             
             break;
     }
-    return o.str();
 }
 
-void Variable::extractLocation(llvm::DWARFDie die)
+/**
+ * Writes the declarator of an argument with as much of its shape as C can
+ * express, float m[static 3][4] for REAL M(4,3).  C needs all but the outermost
+ * extent, which is the last Fortran dimension, so if an inner one isn't known
+ * the argument is just a pointer.  An unknown outermost extent, as for an
+ * assumed-size array, is left empty.
+ */
+void Variable::cArrayParameter(llvm::raw_ostream &o) const
+{
+    auto extent = [](const Dimension &d) -> ptrdiff_t {
+        return d.hasValue() ? d.getValue().second - d.getValue().first + 1 : 0;
+    };
+    
+    bool innerKnown = true;
+    for (size_t i=0; i+1<dims_.size(); ++i) {
+        innerKnown = innerKnown && extent(dims_[i]) > 0;
+    }
+    
+    // the length of a string argument is passed separately
+    if (dims_.empty() || !innerKnown || isString()) {
+        o << " *F2H_RESTRICT " << name_;
+        return;
+    }
+    
+    o << " " << name_ << "[F2H_ARRAY_RESTRICT";
+    if (extent(dims_.back()) > 0) {
+        o << " F2H_STATIC " << extent(dims_.back());
+    }
+    o << "]";
+    for (size_t i=dims_.size()-1; i>0; --i) {
+        o << "[" << extent(dims_[i-1]) << "]";
+    }
+}
+
+/**
+ * The dimensions are listed in Fortran order, fortran_array lays them out column
+ * major.  The lower bound of a dimension without a constant upper bound is
+ * not kept, so it is taken to be the default of 1.
+ */
+void Variable::cxxViewType(llvm::raw_ostream &o) const
+{
+    o << "fortran_array<";
+    if (isString()) {
+        o << "char[" << elementSize_ << "]";
+    } else {
+        cType(o);
+    }
+    for (auto &d : dims_) {
+        if (d.hasValue()) {
+            auto &dval = d.getValue();
+            o << ", dim<" << dval.first << ", " << dval.second - dval.first + 1 << ">";
+        } else {
+            o << ", dim<1>";
+        }
+    }
+    o << ">";
+}
+
+void Variable::checkDeclaration() const
+{
+    llvm::raw_null_ostream null;
+    cDeclaration(null);
+}
+
+bool Variable::extractLocation(Die die)
 {
     using namespace llvm;
     
@@ -245,40 +415,155 @@ void Variable::extractLocation(llvm::DWARFDie die)
     }
     
     auto val = locBlock.getValue();
+    if (val.empty()) {
+        throw std::runtime_error("Variable::extractLocation--empty location");
+    }
+
+    // DWARF 5 and split DWARF can give the address as an index into .debug_addr
+    if (val[0] == dwarf::DW_OP_addrx || val[0] == dwarf::DW_OP_GNU_addr_index) {
+        unsigned n = 0;
+        uint64_t index = decodeULEB128(val.data() + 1, &n);
+        uint64_t addr;
+        if (!die.getDwarfUnit()->getAddrOffsetSectionItem(index, addr)) {
+            throw std::runtime_error("Variable::extractLocation--address index out of range");
+        }
+        location_ = addr;
+        return true;
+    }
+
     if (val[0] != dwarf::DW_OP_addr) {
         throw std::runtime_error("Variable::extractLocation--not an absolute address");
     }
-    uint64_t addr;
-    unsigned char *paddr = reinterpret_cast<unsigned char *>(& addr);
-    std::copy(val.begin()+1, val.begin()+9, paddr);
-    location_ = addr;
+
+    // In a relocatable object the operand is 0 and the address is in a
+    // relocation of .debug_info, which the unit's extractor applies.
+    auto data = die.getDwarfUnit()->getDebugInfoExtractor();
+    auto operand = reinterpret_cast<const char *>(val.data() + 1);
+    if (operand < data.getData().begin() || operand >= data.getData().end()) {
+        throw std::runtime_error("Variable::extractLocation--location is not in .debug_info");
+    }
+    uint32_t offset = operand - data.getData().data();
+    uint32_t rawOffset = offset;
+    uint64_t raw = data.getAddress(&rawOffset);
+    location_ = data.getRelocatedAddress(&offset);
+    return location_ == raw;
 }
 
-void Variable::extractType(llvm::DWARFDie die)
+void Variable::extractType(Die die, ModelArena &arena)
 {
     using namespace llvm;
+    Stats::Timer timer(Stats::Types);
     
-    const uint64_t fail = static_cast<uint64_t>(-1);
-    auto typeDie = die.getAttributeValueAsReferencedDie(dwarf::DW_AT_type);
+    auto typeAttr = die.find(dwarf::DW_AT_type);
+    auto typeDie = die.getAttributeValueAsReferencedDie(dwarf::DW_AT_type, arena.typeUnits());
     if (!typeDie.isValid()) {
         throw std::runtime_error("Variable::extractType--no type attribute");
     }
+    
+    // types that failed to resolve are not memoized and throw again
+    const Type *type = nullptr;
+    if (typeAttr.getValue().getForm() == dwarf::DW_FORM_ref_sig8) {
+        // every object has its own copy of a type unit, the signature identifies it in all of them
+        auto &cache = arena.typeUnits()->cache();
+        uint64_t signature = typeAttr.getValue().getRawUValue();
+        type = cache.find(signature);
+        if (type) {
+            Stats::add(Stats::TypesMemoized);
+        } else {
+            type = resolveType(typeDie, arena);
+            // a derived type lives in the unit's arena, so it is only shared within the unit
+            if (!type->derived) {
+                type = cache.insert(signature, *type);
+            }
+            Stats::add(Stats::TypesResolved);
+        }
+    } else {
+        type = static_cast<const Type *>(arena.memoized(typeDie.getDwarfUnit(), typeDie.getOffset()));
+        if (type) {
+            Stats::add(Stats::TypesMemoized);
+        } else {
+            type = resolveType(typeDie, arena);
+            arena.memoize(typeDie.getDwarfUnit(), typeDie.getOffset(), type);
+            Stats::add(Stats::TypesResolved);
+        }
+    }
+    
+    type_ = type->kind;
+    dims_ = type->dims;
+    isConst_ = type->isConst;
+    elementSize_ = type->byteSize;
+    derived_ = type->derived;
+    descriptorRank_ = type->descriptorRank;
+    elementLength_ = type->elementLength;
+    isAllocatable_ = type->isAllocatable;
+    if (type->isReference && context_ != PARAMETER && context_ != RESULT) {
+        throw std::runtime_error("Variable::extractType--pointers not supported yet");
+    }
+    
+    // We only care about the string length if this is stored in place, as in a common block.
+    // If this is a parameter, then the length is passed as a hidden argument.  A result
+    // keeps its length if it has a fixed one.
+    if (type->isString && context_ != RESULT) {
+        if (context_ == PARAMETER || context_ == STRING_LEN_PARAMETER) {
+            elementSize_ = static_cast<uint64_t>(-1);
+        } else if (elementSize_ == static_cast<uint64_t>(-1)) {
+            throw std::runtime_error("Variable::extractType--no byte size for string");
+        }
+    }
+}
+
+const Variable::Type *Variable::resolveType(Die typeDie, ModelArena &arena)
+{
+    using namespace llvm;
+    
+    const uint64_t fail = static_cast<uint64_t>(-1);
+    Type r;
+    r.dims = ArrayRef<Dimension>();
+    r.isConst = false;
+    r.isString = false;
+    r.derived = nullptr;
+    r.descriptorRank = 0;
+    r.elementLength = 0;
+    r.isAllocatable = false;
+    r.isReference = false;
     auto typeTag = typeDie.getTag();
     
+    // the string result of a function is a reference to its buffer
+    if (typeTag == dwarf::DW_TAG_reference_type) {
+        r.isReference = true;
+        typeDie = typeDie.getAttributeValueAsReferencedDie(dwarf::DW_AT_type, arena.typeUnits());
+        typeTag = typeDie.getTag();
+    }
+    
+    // a POINTER or ALLOCATABLE argument can be a pointer to its descriptor
+    if (typeTag == dwarf::DW_TAG_pointer_type) {
+        auto pointee = typeDie.getAttributeValueAsReferencedDie(dwarf::DW_AT_type, arena.typeUnits());
+        if (pointee.isValid() && pointee.getTag() == dwarf::DW_TAG_array_type && ArrayDescriptor::isDescriptor(pointee)) {
+            r.isReference = true;
+            typeDie = pointee;
+            typeTag = typeDie.getTag();
+        }
+    }
+    
     // arrays and const have the base type information nested one level lower in the tree
     if (typeTag == dwarf::DW_TAG_array_type) {
-        extractArrayDims(typeDie);
+        if (ArrayDescriptor::isDescriptor(typeDie)) {
+            r.descriptorRank = ArrayDescriptor::extractRank(typeDie);
+            r.isAllocatable = typeDie.find({ dwarf::DW_AT_allocated, dwarf::DW_AT_associated }).hasValue();
+        } else {
+            r.dims = extractArrayDims(typeDie, arena);
+        }
         
         // use the type die from the array to get information about individual elements
-        typeDie = typeDie.getAttributeValueAsReferencedDie(dwarf::DW_AT_type);
+        typeDie = typeDie.getAttributeValueAsReferencedDie(dwarf::DW_AT_type, arena.typeUnits());
         typeTag = typeDie.getTag();
     } 
     
     else if (typeTag == dwarf::DW_TAG_const_type) {
-        isConst_ = true;
+        r.isConst = true;
         
         // use the type die from the array to get information about the type of the constant
-        typeDie = typeDie.getAttributeValueAsReferencedDie(dwarf::DW_AT_type);
+        typeDie = typeDie.getAttributeValueAsReferencedDie(dwarf::DW_AT_type, arena.typeUnits());
         typeTag = typeDie.getTag();
     }
     
@@ -289,41 +574,31 @@ void Variable::extractType(llvm::DWARFDie die)
             if(!tmp.hasValue()) {
                 throw std::runtime_error("Variable::extractType--no encoding");
             }
-            type_ = static_cast<llvm::dwarf::TypeKind>(tmp.getValue().getAsUnsignedConstant().getValueOr(fail));
+            r.kind = static_cast<llvm::dwarf::TypeKind>(tmp.getValue().getAsUnsignedConstant().getValueOr(fail));
             
             tmp = typeDie.find(dwarf::DW_AT_byte_size);
             if(!tmp.hasValue()) {
                 throw std::runtime_error("Variable::extractType--no byte size");
             }
-            elementSize_ = tmp.getValue().getAsUnsignedConstant().getValue();
+            r.byteSize = tmp.getValue().getAsUnsignedConstant().getValue();
         }
             break;
             
         case dwarf::DW_TAG_string_type:
         {
             if (std::is_signed<char>::value) {
-                type_ = dwarf::DW_ATE_signed_char;
+                r.kind = dwarf::DW_ATE_signed_char;
             } else {
-                type_ = dwarf::DW_ATE_unsigned_char;
+                r.kind = dwarf::DW_ATE_unsigned_char;
             }
+            r.isString = true;
             
-            // We only care about the string length if this is a common block member for padding determination.
-            // If this is a parameter, then the length is passed as a hidden argument.
-            if (context_ == COMMON_BLOCK_MEMBER) {
-                // string type: then byte size has two possible meanings
-                // if it is the only attribute, then it is the length of the string
-                // if there is also a string length attribute, then it is the byte size of the string length
-                ///\todo check to make sure there is no DW_AT_string_length attribute
-                auto tmp = typeDie.find(dwarf::DW_AT_byte_size);
-                if (!tmp.hasValue()) {
-                    throw std::runtime_error("Variable::extractType--no byte size for string");
-                }
-                else {
-                    elementSize_ = tmp.getValue().getAsUnsignedConstant().getValue();
-                }
-            } else {
-                elementSize_ = fail;
-            }
+            // string type: then byte size has two possible meanings
+            // if it is the only attribute, then it is the length of the string
+            // if there is also a string length attribute, then it is the byte size of the string length
+            ///\todo check to make sure there is no DW_AT_string_length attribute
+            auto tmp = typeDie.find(dwarf::DW_AT_byte_size);
+            r.byteSize = tmp.hasValue() ? tmp.getValue().getAsUnsignedConstant().getValue() : fail;
         }
             break;
             
@@ -340,7 +615,9 @@ void Variable::extractType(llvm::DWARFDie die)
             break;
             
         case dwarf::DW_TAG_structure_type:
-            throw std::runtime_error("Variable::extractType--structures not supported yet");
+            r.derived = DerivedType::extract(typeDie, arena);
+            r.kind = static_cast<llvm::dwarf::TypeKind>(0);
+            r.byteSize = r.derived->byteSize_;
             break;
             
         case dwarf::DW_TAG_pointer_type:
@@ -352,13 +629,24 @@ void Variable::extractType(llvm::DWARFDie die)
             throw std::runtime_error("Variable::extractType--type tag not recognized");
             break;
     }
+    
+    if (r.descriptorRank) {
+        if (r.isString) {
+            throw std::runtime_error("Variable::extractType--CHARACTER arrays with descriptors not supported yet");
+        }
+        r.elementLength = r.byteSize;
+        r.byteSize = ArrayDescriptor::size(r.descriptorRank, typeDie.getDwarfUnit()->getAddressByteSize());
+    }
+    
+    return arena.make<Type>(r);
 }
 
-void Variable::extractArrayDims(llvm::DWARFDie die)
+llvm::ArrayRef<Variable::Dimension> Variable::extractArrayDims(Die die, ModelArena &arena)
 {
     using namespace llvm;
     
     // dimensions
+    SmallVector<Dimension, 4> dims;
     auto dim = die.getFirstChild();
     while (dim.isValid() && !dim.isNULL()) {
         Dimension d(std::make_pair(1, -1));
@@ -372,7 +660,7 @@ void Variable::extractArrayDims(llvm::DWARFDie die)
         }
         else {
             d.reset();
-            dims_.push_back(d);
+            dims.push_back(d);
             dim = dim.getSibling();
             continue;
         }
@@ -383,9 +671,10 @@ void Variable::extractArrayDims(llvm::DWARFDie die)
             auto lb = dimAttr.getValue().getAsSignedConstant();
             if (lb.hasValue()) dval.first = lb.getValue();
         }
-        dims_.push_back(d);
+        dims.push_back(d);
         dim = dim.getSibling();
     }
+    return arena.copy<Dimension>(dims);
 }
 
 size_t Variable::elementCount() const
@@ -5,58 +5,129 @@
 #include <utility>
 #include <vector>
 #include <llvm/BinaryFormat/Dwarf.h>
-#include <llvm/DebugInfo/DWARF/DWARFDie.h>
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/Optional.h>
+#include <llvm/ADT/StringRef.h>
 #include "llvm/Support/raw_ostream.h"
+#include "Die.hpp"
+#include "ModelArena.hpp"
 
 namespace llvm {
     class DWARFDebugInfoEntryMinimal;
     class DWARFCompileUnit;
 }
 
+class DerivedType;
+
 class Variable
 {
 public:
 
     /// lower bound, upper bound
     using Dimension = llvm::Optional<std::pair<ptrdiff_t, ptrdiff_t> >;
-    using Handle = std::unique_ptr<Variable>;
+    using Handle = Variable *;
     
     enum Context {
         PARAMETER,
         STRING_LEN_PARAMETER,
-        COMMON_BLOCK_MEMBER
+        COMMON_BLOCK_MEMBER,
+        STRUCTURE_MEMBER,
+        MODULE_VARIABLE,
+        /// the buffer or descriptor a function returning a string or an array writes its result to
+        RESULT,
+        /// the length of a string RESULT, passed right after it
+        RESULT_LEN_PARAMETER
+    };
+
+    /**
+     * What a DW_AT_type resolves to.  Resolved once per type DIE and unit,
+     * and shared with its dimensions by all the variables of that type.
+     */
+    struct Type {
+        llvm::dwarf::TypeKind kind;
+        /// DW_AT_byte_size of an element, -1 for a string without one
+        uint64_t byteSize;
+        llvm::ArrayRef<Dimension> dims;
+        bool isConst;
+        bool isString;
+        /// null unless the elements are of a derived type, kind is 0 then
+        DerivedType *derived;
+        /**
+         * Rank of an array stored as an ArrayDescriptor, 0 otherwise.  The dims
+         * are empty then and byteSize is the size of the descriptor.
+         */
+        unsigned descriptorRank;
+        /// DW_AT_byte_size of an element of a descriptor array
+        uint64_t elementLength;
+        /// a descriptor array that is ALLOCATABLE or a POINTER, so its data is wherever the callee puts it
+        bool isAllocatable;
+        /// a pointer or reference, only allowed as an argument, which is passed by reference anyway
+        bool isReference;
     };
     
     Variable();
-    virtual ~Variable();
     
-    std::string cDeclaration() const;
-    std::string cType() const {
-        return dwarfToCType(type_, elementSize());
-    }
+    /**
+     * Writes the C declaration to \p o, throws if there is no C equivalent.
+     * With \p declareExtents an argument is declared with its known extents
+     * and as restrict using the F2H_RESTRICT, F2H_ARRAY_RESTRICT and F2H_STATIC
+     * macros, which the header defines for C and C++.  Fortran does not allow
+     * arguments to alias if either is modified, so restrict is always safe.
+     */
+    void cDeclaration(llvm::raw_ostream &o, bool declareExtents = false) const;
+    void cType(llvm::raw_ostream &o) const;
+    
+    /// Writes the C type of an element, which for a descriptor array is not cType.
+    void cElementType(llvm::raw_ostream &o) const;
+    
+    /**
+     * Writes the f2h::fortran_array type viewing this array from C++, with the
+     * Fortran lower bounds and the known extents as template arguments.
+     */
+    void cxxViewType(llvm::raw_ostream &o) const;
+    
+    /// Throws what cDeclaration would without writing anything.
+    void checkDeclaration() const;
     
     size_t elementCount() const;
     
     size_t elementSize() const { return elementSize_; }
     
-    static std::string dwarfToCType(llvm::dwarf::TypeKind, size_t elementSize);
+    static void dwarfToCType(llvm::raw_ostream &o, llvm::dwarf::TypeKind, size_t elementSize);
+    
+    /**
+     * Writes the NumPy dtype of the variable, a subarray for an array with the
+     * dimensions reversed to keep the memory order.  The dtype of a derived
+     * type is a nested structured dtype.
+     */
+    void numpyFormat(llvm::raw_ostream &o) const;
     
-    static Handle extract(Context context, llvm::DWARFDie die);
+    static void dwarfToNumpyType(llvm::raw_ostream &o, llvm::dwarf::TypeKind, size_t elementSize);
+    
+    /// The variable and its dimensions are allocated in \p arena.
+    static Handle extract(Context context, Die die, ModelArena &arena);
     
     /**
      * All common block members should have the location attribute stored as a
      * block1 with the first byte being the op-code for an absolute address followed
-     * by an 8 byte address.
+     * by the address.
      * Local variables and parameters will have a location attribute with a different
      * form and cause this routine to throw an exception.  Location is only needed for
      * common block members to determine padding.
+     *
+     * \return false if the address came from a relocation, as in an object
+     * file.  It is then relative to the block's symbol or section, which is
+     * enough for the offsets of the members but not the block's address.
      */
-    void extractLocation(llvm::DWARFDie die);
+    bool extractLocation(Die die);
+    
+    /// Sets the type from the memoized Type of the variable's DW_AT_type.
+    void extractType(Die die, ModelArena &arena);
     
-    void extractType(llvm::DWARFDie die);
+    static llvm::ArrayRef<Dimension> extractArrayDims(Die die, ModelArena &arena);
     
-    void extractArrayDims(llvm::DWARFDie die);
+    /// Fortran has no unsigned types, those are the padding inserted into common blocks.
+    bool isPadding() const { return type_ == llvm::dwarf::DW_ATE_unsigned; }
     
     bool isString() const { return (type_ == llvm::dwarf::DW_ATE_signed_char ||
         type_ == llvm::dwarf::DW_ATE_unsigned_char); }
@@ -65,9 +136,21 @@ public:
     llvm::dwarf::TypeKind type_;
     uint64_t elementSize_;
     uint64_t location_;
-    std::string name_;
-    std::vector<Dimension> dims_;
+    llvm::StringRef name_;
+    llvm::ArrayRef<Dimension> dims_;
     bool isConst_;
+    /// the type of the elements if they are of a derived type
+    DerivedType *derived_;
+    /// see Type::descriptorRank
+    unsigned descriptorRank_;
+    /// see Type::elementLength
+    uint64_t elementLength_;
+    bool isAllocatable_;
+
+private:
+    void cArrayParameter(llvm::raw_ostream &o) const;
+    
+    static const Type *resolveType(Die typeDie, ModelArena &arena);
 };
 
 llvm::raw_ostream &operator<<(llvm::raw_ostream &o, const Variable &var);
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Generate a synthetic corpus of fixed form FORTRAN 77 sources for benchmarking f2h.
+
+Each file holds a number of subroutines and functions with array arguments of
+increasing rank, CHARACTER arguments and references to a shared set of common
+blocks.  The common blocks are declared identically everywhere they are used,
+so f2h sees the same block in many units just as it does in a real library.
+"""
+
+import argparse
+import os
+import random
+
+TYPES = ['INTEGER*4', 'INTEGER*8', 'REAL*4', 'REAL*8', 'COMPLEX*8', 'COMPLEX*16', 'LOGICAL*4']
+
+
+def statement(text, lines):
+    """Append \\p text as a statement, using continuation lines past column 72."""
+    first = True
+    while text:
+        width = 66
+        chunk, text = text[:width], text[width:]
+        lines.append(('      ' if first else '     &') + chunk)
+        first = False
+
+
+def common_block(k, rank, rng):
+    """Return the name and member declarations for common block number k."""
+    name = 'CBLK%d' % k
+    members = []
+    for m in range(rng.randint(2, 6)):
+        mname = 'C%dM%d' % (k, m)
+        kind = rng.randrange(4)
+        if kind == 0:
+            members.append((mname, rng.choice(TYPES), ''))
+        elif kind == 1:
+            members.append((mname, 'CHARACTER*%d' % rng.choice([1, 8, 16, 80]), ''))
+        else:
+            r = rng.randint(1, rank)
+            dims = ','.join(str(rng.randint(2, 4)) for _ in range(r))
+            members.append((mname, rng.choice(TYPES), '(%s)' % dims))
+    return name, members
+
+
+def subprogram(name, args, rank, strings, commons, is_function, rng):
+    """Return the source lines for one subprogram."""
+    lines = []
+    arrays = ['A%d' % i for i in range(args)]
+    chars = ['S%d' % i for i in range(strings)]
+    params = arrays + chars + ['N']
+    rtype = rng.choice(['INTEGER*4', 'REAL*4', 'REAL*8'])
+    if is_function:
+        statement('%s FUNCTION %s(%s)' % (rtype, name, ', '.join(params)), lines)
+    else:
+        statement('SUBROUTINE %s(%s)' % (name, ', '.join(params)), lines)
+    lines.append('      IMPLICIT NONE')
+    lines.append('      INTEGER N')
+
+    for i, a in enumerate(arrays):
+        r = 1 + i % rank
+        dims = ['N'] * (r - 1) + ['*']
+        statement('%s %s(%s)' % (rng.choice(TYPES[:4]), a, ','.join(dims)), lines)
+    for s in chars:
+        lines.append('      CHARACTER*(*) %s' % s)
+
+    for cname, members in commons:
+        statement('COMMON /%s/ %s' % (cname, ', '.join(m[0] for m in members)), lines)
+        for mname, mtype, mdims in members:
+            statement('%s %s%s' % (mtype, mname, mdims), lines)
+
+    # touch everything so nothing is optimized away
+    for i, a in enumerate(arrays):
+        r = 1 + i % rank
+        ref = '%s(%s)' % (a, ','.join(['1'] * r))
+        statement('%s = %s + 1' % (ref, ref), lines)
+    for s in chars:
+        lines.append("      %s(1:1) = 'X'" % s)
+    for cname, members in commons:
+        mname, mtype, mdims = members[0]
+        if mdims:
+            mname += '(%s)' % ','.join(['1'] * (mdims.count(',') + 1))
+        if mtype.startswith('CHARACTER'):
+            lines.append("      %s(1:1) = 'Y'" % mname)
+        elif mtype.startswith('LOGICAL'):
+            lines.append('      %s = .TRUE.' % mname)
+        else:
+            lines.append('      %s = %s + 1' % (mname, mname))
+    if is_function:
+        lines.append('      %s = N' % name)
+    lines.append('      END')
+    lines.append('')
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--output-dir', required=True, help='directory for the generated .f files')
+    parser.add_argument('--files', type=int, default=16, help='number of source files')
+    parser.add_argument('--subprograms', type=int, default=200, help='subroutines and functions per file')
+    parser.add_argument('--commons', type=int, default=32, help='number of distinct common blocks')
+    parser.add_argument('--commons-per-subprogram', type=int, default=2)
+    parser.add_argument('--args', type=int, default=6, help='array arguments per subprogram')
+    parser.add_argument('--rank', type=int, default=7, help='highest array rank')
+    parser.add_argument('--strings', type=int, default=3, help='CHARACTER arguments per subprogram')
+    parser.add_argument('--seed', type=int, default=1)
+    opts = parser.parse_args()
+
+    rng = random.Random(opts.seed)
+    blocks = [common_block(k, opts.rank, rng) for k in range(opts.commons)]
+
+    if not os.path.isdir(opts.output_dir):
+        os.makedirs(opts.output_dir)
+    for f in range(opts.files):
+        lines = []
+        for i in range(opts.subprograms):
+            n = min(opts.commons_per_subprogram, len(blocks))
+            lines += subprogram('F%dP%d' % (f, i), opts.args, opts.rank, opts.strings,
+                                rng.sample(blocks, n), i % 4 == 3, rng)
+        path = os.path.join(opts.output_dir, 'corpus%d.f' % f)
+        with open(path, 'w') as out:
+            out.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Time f2h end to end on a generated corpus.
+
+Generates the corpus with gen_corpus.py, compiles it with gfortran -g and runs
+f2h on the objects a number of times.  Reports the wall time, throughput in
+input bytes, subprograms and DIEs per second, and the peak RSS of f2h.
+
+Arguments after -- are passed to f2h, e.g. run_bench.py --f2h ./f2h -- -j8
+"""
+
+import argparse
+import concurrent.futures
+import json
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def find_dwarfdump(name):
+    if name:
+        return name
+    for candidate in ['llvm-dwarfdump'] + ['llvm-dwarfdump-%d' % v for v in range(20, 4, -1)]:
+        path = shutil.which(candidate)
+        if path:
+            return path
+    return None
+
+
+def generate(opts, srcdir):
+    cmd = [sys.executable, os.path.join(HERE, 'gen_corpus.py'), '--output-dir', srcdir,
+           '--files', str(opts.files), '--subprograms', str(opts.subprograms),
+           '--commons', str(opts.commons), '--args', str(opts.args), '--rank', str(opts.rank),
+           '--strings', str(opts.strings), '--seed', str(opts.seed)]
+    subprocess.check_call(cmd)
+    return sorted(os.path.join(srcdir, f) for f in os.listdir(srcdir) if f.endswith('.f'))
+
+
+def compile_sources(opts, sources):
+    def build(src):
+        obj = src[:-2] + '.o'
+        if not os.path.exists(obj) or os.path.getmtime(obj) < os.path.getmtime(src):
+            subprocess.check_call([opts.fc] + opts.fflags.split() + ['-c', src, '-o', obj])
+        return obj
+    with concurrent.futures.ThreadPoolExecutor(os.cpu_count() or 1) as pool:
+        return list(pool.map(build, sources))
+
+
+def count_dies(dwarfdump, objects):
+    """Counts the DIEs, including null entries, as f2h has to read them."""
+    if not dwarfdump:
+        return None
+    entry = re.compile(rb'^0x[0-9a-f]+: ', re.M)
+    total = 0
+    for obj in objects:
+        out = subprocess.check_output([dwarfdump, '--debug-info', obj], stderr=subprocess.DEVNULL)
+        total += len(entry.findall(out))
+    return total
+
+
+def run_once(cmd):
+    """Returns the wall time in seconds and peak RSS in kB of one f2h run."""
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    if not os.WIFEXITED(status) or os.WEXITSTATUS(status) != 0:
+        raise RuntimeError('%s failed with status %d' % (' '.join(cmd), status))
+    # ru_maxrss is in bytes on macOS and kB elsewhere
+    rss = usage.ru_maxrss // 1024 if sys.platform == 'darwin' else usage.ru_maxrss
+    return elapsed, rss
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--f2h', required=True, help='f2h executable to time')
+    parser.add_argument('--work-dir', default='bench-work', help='where the corpus is generated and built')
+    parser.add_argument('--fc', default=os.environ.get('FC', 'gfortran'))
+    parser.add_argument('--fflags', default=os.environ.get('FFLAGS', '-O -g -gdwarf-4 -Wno-align-commons'))
+    parser.add_argument('--dwarfdump', help='llvm-dwarfdump used to count DIEs, searched for if not given')
+    parser.add_argument('--archive', action='store_true', help='pack the objects into a static library first')
+    parser.add_argument('--repeat', type=int, default=5)
+    parser.add_argument('--json', action='store_true', help='print the results as JSON')
+    parser.add_argument('--files', type=int, default=16)
+    parser.add_argument('--subprograms', type=int, default=200)
+    parser.add_argument('--commons', type=int, default=32)
+    parser.add_argument('--args', type=int, default=6)
+    parser.add_argument('--rank', type=int, default=7)
+    parser.add_argument('--strings', type=int, default=3)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('f2h_args', nargs='*', help='extra f2h arguments, after --')
+    opts = parser.parse_args()
+
+    # each corpus shape gets its own directory so objects are only rebuilt when needed
+    shape = 'f%d-s%d-c%d-a%d-r%d-s%d-seed%d' % (opts.files, opts.subprograms, opts.commons,
+                                               opts.args, opts.rank, opts.strings, opts.seed)
+    srcdir = os.path.join(opts.work_dir, shape)
+    objects = compile_sources(opts, generate(opts, srcdir))
+    inputs = objects
+    if opts.archive:
+        lib = os.path.join(srcdir, 'libcorpus.a')
+        if os.path.exists(lib):
+            os.remove(lib)
+        subprocess.check_call(['ar', 'rcs', lib] + objects)
+        inputs = [lib]
+
+    nbytes = sum(os.path.getsize(f) for f in inputs)
+    nsubprograms = opts.files * opts.subprograms
+    ndies = count_dies(find_dwarfdump(opts.dwarfdump), objects)
+
+    cmd = [opts.f2h] + opts.f2h_args + inputs
+    runs = [run_once(cmd) for _ in range(opts.repeat)]
+    times = [r[0] for r in runs]
+    best = min(times)
+
+    results = {
+        'command': ' '.join(cmd[:1] + opts.f2h_args),
+        'inputs': len(inputs),
+        'bytes': nbytes,
+        'subprograms': nsubprograms,
+        'dies': ndies,
+        'runs': opts.repeat,
+        'best_s': best,
+        'median_s': statistics.median(times),
+        'mb_per_s': nbytes / best / 1e6,
+        'subprograms_per_s': nsubprograms / best,
+        'dies_per_s': ndies / best if ndies else None,
+        'peak_rss_kb': max(r[1] for r in runs),
+    }
+    if opts.json:
+        print(json.dumps(results, indent=2))
+        return
+
+    print('command       %s' % results['command'])
+    print('inputs        %d files, %.1f MB, %d subprograms, %s DIEs'
+          % (len(inputs), nbytes / 1e6, nsubprograms, ndies if ndies else 'unknown'))
+    print('wall time     best %.3f s, median %.3f s of %d runs'
+          % (best, results['median_s'], opts.repeat))
+    print('throughput    %.1f MB/s, %.0f subprograms/s' % (results['mb_per_s'], results['subprograms_per_s']))
+    if ndies:
+        print('              %.0f DIEs/s' % results['dies_per_s'])
+    print('peak RSS      %.1f MB' % (results['peak_rss_kb'] / 1024.0))
+
+
+if __name__ == '__main__':
+    main()
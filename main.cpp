@@ -1,33 +1,26 @@
-#include "llvm/ADT/STLExtras.h"
-#include "llvm/ADT/Triple.h"
-#include "llvm/DebugInfo/DIContext.h"
-#include "llvm/DebugInfo/DWARF/DWARFContext.h"
-#include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
-#include "llvm/DebugInfo/DWARF/DWARFDebugInfoEntry.h"
-#include "llvm/Object/ObjectFile.h"
-#include "llvm/Object/RelocVisitor.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/CommandLine.h"
-#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/BinaryFormat/Dwarf.h"
-#include <algorithm>
-#include <cstring>
-#include <list>
+#include <chrono>
+#include <map>
+#include <memory>
 #include <string>
 #include <system_error>
-#include <iostream>
-#include <fstream>
-#include "Variable.hpp"
-#include "CommonBlock.hpp"
-#include "Subprogram.hpp"
+#include <vector>
+#include "Generator.hpp"
+#include "InputWatcher.hpp"
+#include "LayoutReport.hpp"
+#include "Stats.hpp"
+#include "TimeTrace.hpp"
 
 using namespace llvm;
-using namespace object;
 
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::desc("<input object files>"),
@@ -38,71 +31,173 @@ static cl::opt<std::string> OutputFilename("output", cl::value_desc("output"),
 static cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                           cl::aliasopt(OutputFilename));
 
-static std::ostream *outputStream(&std::cout);
+static cl::opt<unsigned> Jobs("j", cl::Prefix, cl::value_desc("N"), cl::init(1),
+                              cl::desc("Number of threads used to extract object files and "
+                                       "compile units, 0 for one per hardware thread"));
+static cl::alias JobsA("jobs", cl::desc("Alias for -j"), cl::aliasopt(Jobs));
+
+static cl::opt<std::string> CacheDirectory("cache-dir", cl::value_desc("directory"),
+                                           cl::desc("Reuse models extracted from unchanged object files "
+                                                    "by caching them in this directory"));
+
+static cl::list<std::string> Symbols("symbols", cl::CommaSeparated, cl::value_desc("name|/regex/|@file"),
+                                     cl::desc("Only declare the subprograms with these linkage names "
+                                              "(e.g. dgemm_), names matching /regex/ or listed in @file"));
+static cl::opt<bool> ExportedOnly("exported-only",
+                                  cl::desc("Only declare the subprograms exported by each input: the dynamic "
+                                           "symbols of a shared library or the global symbols of an object"));
+
+static cl::opt<bool> NameIndex("name-index",
+                               cl::desc("Read the subprograms from .debug_pubnames where there is one instead of "
+                                        "scanning every compile unit, this may leave out ones that are not external"));
+
+static cl::opt<bool> ArrayExtents("array-extents",
+                                  cl::desc("Declare arguments with their known array extents, e.g. "
+                                           "float v[static 3] or float m[][4], and as restrict"));
+
+static cl::opt<bool> CxxViews("cxx-views",
+                              cl::desc("Add C++ column-major views, indexed like in Fortran, for array "
+                                       "arguments and common block arrays"));
+
+static cl::opt<bool> CxxStrings("cxx-strings",
+                                cl::desc("Add C++ overloads that pass the hidden lengths of CHARACTER "
+                                         "arguments from string literals, char arrays and strings"));
+
+static cl::opt<bool> CxxResults("cxx-results",
+                                cl::desc("Add C++ overloads of functions returning strings or arrays "
+                                         "that write the result to a buffer of the caller"));
+
+static cl::opt<bool> SplitHeader("split-header",
+                                 cl::desc("Write a header per source file, <output>_common.h and "
+                                          "<output>_types.h next to the --output, which includes them"));
+
+static cl::opt<std::string> LayoutReportFilename("layout-report", cl::value_desc("file"),
+                                                 cl::desc("Write the byte layout of every common block, with "
+                                                          "misaligned members, cache line sharing and padding"));
+static cl::opt<LayoutReport::Format>
+LayoutFormat("layout-format", cl::desc("Format of the --layout-report"), cl::init(LayoutReport::Text),
+             cl::values(clEnumValN(LayoutReport::Text, "text", "aligned columns"),
+                        clEnumValN(LayoutReport::JSON, "json", "one JSON object")));
+static cl::opt<unsigned> CacheLineSize("cache-line-size", cl::value_desc("bytes"), cl::init(64),
+                                       cl::desc("Cache line size assumed by the --layout-report"));
+
+static cl::opt<std::string> PythonModuleFilename("python-module", cl::value_desc("file.py"),
+                                                 cl::desc("Write a Python module with NumPy dtypes of the common "
+                                                          "blocks and zero-copy views of them in a loaded library"));
+
+enum ModelFormatOption { ModelBinary, ModelJSON };
+static cl::opt<std::string> EmitModelFilename("emit-model", cl::value_desc("file"),
+                                              cl::desc("Write the declared subprograms, common blocks, derived "
+                                                       "types and module variables as a model for other tools, "
+                                                       "see ModelReader"));
+static cl::opt<ModelFormatOption>
+EmitModelFormat("model-format", cl::desc("Format of the --emit-model"), cl::init(ModelBinary),
+                cl::values(clEnumValN(ModelBinary, "binary", "memory mappable tables"),
+                           clEnumValN(ModelJSON, "json", "the same tables as JSON, for debugging")));
+
+static cl::opt<bool> Watch("watch",
+                           cl::desc("Keep running and rewrite the output whenever an input changes, "
+                                    "extracting only the changed inputs again"));
+static cl::opt<unsigned> WatchSettle("watch-settle", cl::value_desc("ms"), cl::init(20),
+                                     cl::desc("With --watch, wait until the inputs have not changed "
+                                              "for this long before rewriting the output"));
+
+// --stats is taken by LLVM's statistics, which f2h doesn't use
+static cl::opt<bool> StatsEnabled("f2h-stats",
+                                  cl::desc("Print counters and the time spent in each phase to stderr"));
+static cl::opt<bool> TimeTraceEnabled("time-trace",
+                                      cl::desc("Write a Chrome trace of the work done for each input file "
+                                               "to <input file name>.time-trace.json, numbered if several "
+                                               "inputs have the same name"));
+static cl::opt<std::string> TimeTraceDirectory("time-trace-dir", cl::value_desc("directory"),
+                                               cl::desc("Directory for the --time-trace files, defaults "
+                                                        "to the directory of the output file"));
 
 static int ReturnValue = EXIT_SUCCESS;
 
-static bool error(StringRef Filename, std::error_code EC) {
-  if (!EC)
-    return false;
-  errs() << Filename << ": " << EC.message() << "\n";
-  ReturnValue = EXIT_FAILURE;
-  return true;
+/**
+ * Replaces \p filename with \p contents unless it already has them, so its
+ * time stamp only changes with its contents and nothing including it is
+ * rebuilt needlessly.  The new contents are renamed into place, so a build
+ * reading the file never sees half of it.
+ */
+static void writeIfChanged(const std::string &filename, StringRef contents)
+{
+    auto existing = MemoryBuffer::getFile(filename, -1, false);
+    if (existing && existing.get()->getBuffer() == contents) {
+        return;
+    }
+
+    std::string temporary = filename + ".f2h-tmp";
+    {
+        std::error_code ec;
+        raw_fd_ostream os(temporary, ec, sys::fs::F_None);
+        if (ec) {
+            errs() << "failed to open " << temporary << ": " << ec.message() << '\n';
+            ReturnValue = EXIT_FAILURE;
+            return;
+        }
+        os << contents;
+    }
+    if (std::error_code ec = sys::fs::rename(temporary, filename)) {
+        errs() << "failed to replace " << filename << ": " << ec.message() << '\n';
+        ReturnValue = EXIT_FAILURE;
+    }
 }
 
-/**
- * Traverse the graph looking for common blocks and subprograms.
- * Assume the starting node is an object file with a single compile unit.
- * Immediate children of the compile uniit will be subprograms.
- * Immediate children of the subprograms will be the common blocks.
+/// Writes the output of \p write to \p filename if it changed.
+template <typename Write>
+static void writeOutput(const std::string &filename, Write write)
+{
+    std::string contents;
+    raw_string_ostream os(contents);
+    write(os);
+    writeIfChanged(filename, os.str());
+}
 
- http://llvm.org/doxygen/classllvm_1_1DWARFDebugInfoEntryMinimal.html
- http://www.dwarfstd.org/doc/DWARF4.pdf
+/**
+ * Writes the header, or the split headers, followed by the other outputs that
+ * were asked for.  A header going to standard output is streamed.
  */
-static void extractObject(ObjectFile &obj)
+static void writeOutputs(Generator &generator)
 {
-    std::unique_ptr<DWARFContextInMemory> DICtx(new DWARFContextInMemory(obj));
-
-
-    auto cuit = DICtx->compile_units();
-    for (auto &cu : cuit) {
-        
-        // calling this with false reads in the entire DIE list for this cu so we can walk through it.
-        auto cudie = cu->getUnitDIE(false);
-        
-        // ensure compilation unit is fortran
-        auto lang = cudie.find(dwarf::DW_AT_language).getValue().getAsUnsignedConstant().getValue();
-        //auto lang = form.getAsUnsignedConstant().getValueOr(-1);
-        if (!(lang == dwarf::DW_LANG_Fortran77 ||
-              lang == dwarf::DW_LANG_Fortran90 ||
-              lang == dwarf::DW_LANG_Fortran95)) {
-            errs() << cudie.getName(DINameKind::ShortName) << " is not FORTRAN 77,90, or 95.  Skipping\n";
-            continue;
+    if (SplitHeader) {
+        SmallString<128> dir = sys::path::parent_path(OutputFilename);
+        for (auto &file : generator.writeSplitHeader(OutputFilename)) {
+            SmallString<128> path(dir);
+            sys::path::append(path, file.name);
+            writeIfChanged(path.str().str(), file.contents);
+            Stats::add(Stats::BytesWritten, file.contents.size());
         }
-        
-        *outputStream << "// compilation unit: " << cudie.getName(DINameKind::ShortName) << std::endl;
-        
-        // look for children of the compile unit that are subprograms
-        // immediate children of the subprogram include parameters, common blocks, and local variables
-        auto die = cudie.getFirstChild();
-        while (die && !die.isNULL()) {
-            if (die.isSubprogramDIE()) {
-                try {
-                    Subprogram::Handle sub = Subprogram::extract(die);
-                    // empty return w/o error means not a callable subprogram so just ignore
-                    if (sub) {
-                        *outputStream << sub->cDeclaration() << std::endl;
-                    }
-                } catch (std::runtime_error &ex) {
-                    // skip the subroutine if something goes wrong with the extraction
-                    // err message printed at site of throw
-                }
-            }
-            die = die.getSibling();
-        }
-        *outputStream << std::endl;
+    } else if (!OutputFilename.compare("-")) {
+        outs().SetBufferSize(1 << 20);
+        generator.writeHeader(outs());
+        Stats::add(Stats::BytesWritten, outs().tell());
+        outs().flush();
+    } else {
+        writeOutput(OutputFilename, [&generator](raw_ostream &os) {
+            generator.writeHeader(os);
+            Stats::add(Stats::BytesWritten, os.tell());
+        });
+    }
+
+    if (!EmitModelFilename.empty()) {
+        writeOutput(EmitModelFilename, [&generator](raw_ostream &os) {
+            generator.writeModel(os, EmitModelFormat == ModelJSON);
+        });
     }
 
+    if (!PythonModuleFilename.empty()) {
+        writeOutput(PythonModuleFilename, [&generator](raw_ostream &os) {
+            generator.writePythonModule(os);
+        });
+    }
+
+    if (!LayoutReportFilename.empty()) {
+        writeOutput(LayoutReportFilename, [&generator](raw_ostream &os) {
+            generator.writeLayoutReport(os, CacheLineSize, LayoutFormat);
+        });
+    }
 }
 
 int main(int argc, char **argv) {
@@ -112,6 +207,8 @@ int main(int argc, char **argv) {
     llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
     
     cl::ParseCommandLineOptions(argc, argv, "f2h\n");
+    auto startTime = std::chrono::steady_clock::now();
+    Stats::enabled_ = StatsEnabled;
     
     // Defaults to a.out if no filenames specified.
     if (InputFilenames.size() == 0) {
@@ -119,56 +216,99 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
     
-    if (OutputFilename.compare("-")) {
-        outputStream = new std::ofstream(OutputFilename.c_str(), std::ofstream::trunc);
+    Generator::Options options;
+    options.jobs = Jobs;
+    options.cacheDirectory = CacheDirectory;
+    options.symbols = Symbols;
+    options.exportedOnly = ExportedOnly;
+    options.nameIndex = NameIndex;
+    // the models of unchanged inputs outlive the mappings of files that may be truncated and rewritten
+    options.copyNames = Watch;
+    options.arrayExtents = ArrayExtents;
+    options.cxxViews = CxxViews;
+    options.cxxStrings = CxxStrings;
+    options.cxxResults = CxxResults;
+    std::unique_ptr<Generator> generator;
+    try {
+        generator.reset(new Generator(options));
+    } catch (std::runtime_error &ex) {
+        errs() << ex.what() << '\n';
+        return EXIT_FAILURE;
     }
-    
-    
-    // output header
-    // kludge c99 complex compatibility with c++
-    *outputStream << "// automatically generated by f2h" << std::endl << std::endl <<
-    "#include <stdint.h>" << std::endl << std::endl <<
-    "#ifdef __cplusplus" << std::endl <<
-    "#include <complex>" << std::endl <<
-    "using float_complex = std::complex<float>;" << std::endl <<
-    "using double_complex = std::complex<double>;" << std::endl <<
-    "using long_double_complex = std::complex<long double>;" << std::endl <<
-    "extern \"C\" {" << std::endl <<
-    "#else" << std::endl <<
-    "#include <complex.h>" << std::endl <<
-    "typedef float complex float_complex;" << std::endl <<
-    "typedef double complex double_complex;" << std::endl <<
-    "typedef long double complex long_double_complex;" << std::endl <<
-    "#endif" << std::endl << std::endl;
-
-    for (StringRef filename : InputFilenames) {
-        ErrorOr<std::unique_ptr<MemoryBuffer>> BuffOrErr = MemoryBuffer::getFileOrSTDIN(filename);
-        if (error(filename, BuffOrErr.getError())) {
-            errs() << "failed to open " << filename << '\n';
-            continue;
+    for (auto &filename : InputFilenames) {
+        generator->addFile(filename);
+    }
+
+    if ((Watch || SplitHeader) && !OutputFilename.compare("-")) {
+        errs() << (Watch ? "--watch" : "--split-header") << " needs an --output file\n";
+        return EXIT_FAILURE;
+    }
+
+    // started before the first extraction so no change is missed
+    std::unique_ptr<InputWatcher> watcher;
+    if (Watch) {
+        try {
+            watcher.reset(new InputWatcher(InputFilenames));
+        } catch (std::runtime_error &ex) {
+            errs() << ex.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::unique_ptr<TimeTrace> > traces;
+    std::vector<TimeTrace *> tracePointers;
+    if (TimeTraceEnabled) {
+        SmallString<128> dir(TimeTraceDirectory);
+        if (dir.empty() && OutputFilename.compare("-")) {
+            dir = sys::path::parent_path(OutputFilename);
+        }
+        // inputs from different directories can have the same name
+        std::map<std::string, unsigned> names;
+        for (auto &filename : InputFilenames) {
+            ++names[sys::path::filename(filename).str()];
         }
-        std::unique_ptr<MemoryBuffer> Buff = std::move(BuffOrErr.get());
-        
-        auto ObjOrErr = ObjectFile::createObjectFile(Buff->getMemBufferRef());
-        if (error(filename, errorToErrorCode(ObjOrErr.takeError()))) {
-            errs() << "failed to create object file " << filename << '\n';
-            continue;
+        for (size_t i=0; i<InputFilenames.size(); ++i) {
+            std::string name = sys::path::filename(InputFilenames[i]).str();
+            if (names[name] > 1) {
+                name += "." + std::to_string(i);
+            }
+            SmallString<128> path(dir);
+            sys::path::append(path, name + ".time-trace.json");
+            traces.emplace_back(new TimeTrace(path.str().str()));
+            tracePointers.push_back(traces.back().get());
         }
-        ObjectFile &Obj = *ObjOrErr.get();
-        extractObject(Obj);
     }
+
+    generator->extract(tracePointers);
+    writeOutputs(*generator);
     
-    // output common blocks
-    *outputStream << std::endl << std::endl << "// common blocks" << std::endl;
-    for (auto &cbit : CommonBlock::map_) {
-        *outputStream << cbit.second->cDeclaration() << std::endl;
+    // only the first extraction is traced
+    for (auto &trace : traces) {
+        trace->write();
     }
-
-    *outputStream << "#ifdef __cplusplus" << std::endl << "}" << std::endl << "#endif" << std::endl;
     
-    if (outputStream != &std::cout) {
-        delete outputStream;
+    if (Stats::enabled_) {
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - startTime;
+        Stats::print(errs(), wall.count());
+    }
+
+    // The models of unchanged inputs are kept, only the changed inputs are
+    // extracted again.  Runs until interrupted.
+    while (watcher) {
+        std::vector<size_t> changed;
+        try {
+            changed = watcher->wait(std::chrono::milliseconds(WatchSettle));
+        } catch (std::runtime_error &ex) {
+            errs() << ex.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        auto start = std::chrono::steady_clock::now();
+        generator->extract(changed, std::vector<TimeTrace *>());
+        writeOutputs(*generator);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        errs() << "regenerated " << OutputFilename << " for " << changed.size() << " changed input(s) in "
+               << format("%.1f", elapsed.count()) << " ms\n";
     }
 
-    return ReturnValue;
+    return generator->failed() ? EXIT_FAILURE : ReturnValue;
 }
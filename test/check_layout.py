@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+"""Compares the member offsets of a JSON --layout-report with the offsets
+FORTRAN prints, one "<member> <offset>" per line.
+
+usage: check_layout.py <report.json> <offsets.txt>
+"""
+import json
+import sys
+
+
+def main(report_file, offsets_file):
+    with open(report_file) as f:
+        report = json.load(f)
+    with open(offsets_file) as f:
+        offsets = dict((name, int(offset)) for name, offset in (line.split() for line in f if line.strip()))
+
+    failures = 0 if report['blocks'] else 1
+    for block in report['blocks']:
+        members = [m for m in block['members'] if not m['padding']]
+        for m in members:
+            if m['name'] in offsets and m['offset'] != offsets[m['name']]:
+                print('%s.%s is at %d, FORTRAN has it at %d' % (block['name'], m['name'], m['offset'],
+                                                               offsets[m['name']]))
+                failures += 1
+        # an EQUIVALENCE keeps one name for the shared storage
+        distinct = set(offsets.values())
+        if len(members) != len(distinct):
+            print('%s has %d members, FORTRAN has %d distinct offsets' % (block['name'], len(members),
+                                                                         len(distinct)))
+            failures += 1
+    return failures != 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(*sys.argv[1:]))
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Calls COMMON_SET in a shared library built from commons.f and reads what
+it wrote to /MIXED/ through the --python-module of the object file.
+
+usage: check_python_module.py <module.py> <library>
+"""
+import ctypes
+import importlib.util
+import os
+import sys
+
+
+def main(module_file, library):
+    try:
+        import numpy
+    except ImportError:
+        print('skipping the python module check, numpy is not installed')
+        return 0
+
+    spec = importlib.util.spec_from_file_location('commons', module_file)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+
+    lib = ctypes.CDLL(os.path.abspath(library), ctypes.RTLD_GLOBAL)
+    lib.common_set_()
+    mixed = module.CommonBlock(lib, 'mixed_')
+
+    failures = 0
+    # X and Z are EQUIVALENCEd, only one of them is a member
+    x = mixed.x if 'x' in dir(mixed) else mixed.z
+    for name, value, expected in [('i', mixed.i, 7), ('x', x, 1.5), ('k', mixed.k, 9),
+                                  ('y', list(mixed.y), [2.5, 3.5, 4.5])]:
+        if value != expected:
+            print('mixed.%s is %s, FORTRAN wrote %s' % (name, value, expected))
+            failures += 1
+
+    # the view is the block itself
+    mixed.k = 11
+    if ctypes.c_int32.from_address(ctypes.addressof(ctypes.c_char.in_dll(lib, 'mixed_')) +
+                                   module.mixed_.fields['k'][1]).value != 11:
+        print('assigning to mixed.k did not write the block')
+        failures += 1
+    return failures != 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(*sys.argv[1:]))
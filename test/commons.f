@@ -0,0 +1,40 @@
+!     Common blocks for the checks of member offsets.  In an object file
+!     the members are only located through relocations of .debug_info.
+
+!     Sets every member of /MIXED/
+      SUBROUTINE COMMON_SET
+
+      IMPLICIT NONE
+
+      COMMON /MIXED/ I, X, Y, K
+      INTEGER*4 I, K
+      REAL*8 X, Y(3), Z
+      EQUIVALENCE (X, Z)
+
+      I = 7
+      Z = 1.5
+      Y(1) = 2.5
+      Y(2) = 3.5
+      Y(3) = 4.5
+      K = 9
+
+      END
+
+
+!     Prints the offset of each member of /MIXED/ from the start of the block
+      SUBROUTINE COMMON_OFFSETS
+
+      IMPLICIT NONE
+
+      COMMON /MIXED/ I, X, Y, K
+      INTEGER*4 I, K
+      REAL*8 X, Y(3), Z
+      EQUIVALENCE (X, Z)
+
+      PRINT '(A,I0)', 'i ', LOC(I) - LOC(I)
+      PRINT '(A,I0)', 'x ', LOC(X) - LOC(I)
+      PRINT '(A,I0)', 'z ', LOC(Z) - LOC(I)
+      PRINT '(A,I0)', 'y ', LOC(Y) - LOC(I)
+      PRINT '(A,I0)', 'k ', LOC(K) - LOC(I)
+
+      END
@@ -0,0 +1,46 @@
+! Assumed-shape, ALLOCATABLE and POINTER arrays, which are passed as descriptors
+
+! Returns what FORTRAN sees of A and M in INFO: the extents, A(2), the sum of
+! A and M(2,3), and doubles the elements of A
+subroutine shape_info(a, m, info)
+  implicit none
+  real(8), intent(inout) :: a(:)
+  real(8), intent(in) :: m(:,:)
+  real(8), intent(out) :: info(6)
+
+  info(1) = size(a)
+  info(2) = size(m, 1)
+  info(3) = size(m, 2)
+  info(4) = a(2)
+  info(5) = sum(a)
+  info(6) = m(2,3)
+  a = 2 * a
+end subroutine
+
+! Allocates V(0:N-1) with V(I) = I
+subroutine alloc_range(v, n)
+  implicit none
+  real(8), allocatable, intent(out) :: v(:)
+  integer(4), intent(in) :: n
+  integer(4) :: i
+
+  allocate(v(0:n-1))
+  do i = 0, n-1
+    v(i) = i
+  end do
+end subroutine
+
+! Points P at every other row of a saved 4x3 grid with GRID(I,J) = 10*I + J
+subroutine point_rows(p)
+  implicit none
+  real(8), pointer, intent(out) :: p(:,:)
+  real(8), target, save :: grid(4,3)
+  integer(4) :: i, j
+
+  do j = 1, 3
+    do i = 1, 4
+      grid(i,j) = 10*i + j
+    end do
+  end do
+  p => grid(1:4:2, :)
+end subroutine
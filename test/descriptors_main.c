@@ -0,0 +1,70 @@
+/* Calls descriptors.f90 with descriptors built by f2h_array_rN_of and reads
+   the ones FORTRAN filled in */
+#include <stdio.h>
+#include <stdlib.h>
+#include "descriptors.h"
+
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+    if (!ok) {
+        printf("%s failed\n", what);
+        ++failures;
+    }
+}
+
+int main()
+{
+    /* every other element of v is the array a(4) */
+    double v[8] = { 1, -1, 2, -1, 3, -1, 4, -1 };
+    ptrdiff_t a_extent[1] = { 4 };
+    ptrdiff_t a_stride[1] = { 2 * sizeof(double) };
+    f2h_array_r1 a = f2h_array_r1_of(v, sizeof(double), F2H_TYPE_REAL, a_extent, a_stride);
+
+    /* m(3,5) with m(i,j) = 10*i + j */
+    double m[5][3];
+    int i, j;
+    for (j = 0; j < 5; ++j) {
+        for (i = 0; i < 3; ++i) {
+            m[j][i] = 10 * (i + 1) + j + 1;
+        }
+    }
+    ptrdiff_t m_extent[2] = { 3, 5 };
+    f2h_array_r2 md = f2h_array_r2_of(m, sizeof(double), F2H_TYPE_REAL, m_extent, NULL);
+
+    double info[6];
+    shape_info_(&a, &md, info);
+    check(info[0] == 4 && info[1] == 3 && info[2] == 5, "extents");
+    check(info[3] == 2, "strided element");
+    check(info[4] == 10, "sum of a strided array");
+    check(info[5] == 23, "m(2,3)");
+    check(v[0] == 2 && v[1] == -1 && v[6] == 8 && v[7] == -1, "writing a strided array");
+
+    /* FORTRAN allocates an unallocated descriptor */
+    f2h_array_r1 r = { 0 };
+    int32_t n = 5;
+    alloc_range_(&r, &n);
+    check(r.base_addr != NULL, "allocated");
+    if (r.base_addr) {
+        double *rv = r.base_addr;
+        check(r.dim[0].lower_bound == 0 && r.dim[0].upper_bound == 4, "allocated bounds");
+        check(rv[0] == 0 && rv[4] == 4, "allocated elements");
+        free(r.base_addr);
+    }
+
+    /* a pointer to rows 1 and 3 of a 4x3 grid */
+    f2h_array_r2 p = { 0 };
+    point_rows_(&p);
+    check(p.dim[1].upper_bound - p.dim[1].lower_bound == 2 &&
+          p.dim[0].upper_bound - p.dim[0].lower_bound == 1, "pointer extents");
+    for (j = 0; j < 3; ++j) {
+        for (i = 0; i < 2; ++i) {
+            double *e = (double *)((char *)p.base_addr +
+                                   (i * p.dim[0].stride + j * p.dim[1].stride) * p.span);
+            check(*e == 10 * (2 * i + 1) + j + 1, "element of a pointer");
+        }
+    }
+
+    return failures != 0;
+}
@@ -0,0 +1,3 @@
+      PROGRAM LAYOUT_MAIN
+      CALL COMMON_OFFSETS
+      END
@@ -0,0 +1,178 @@
+// Writes a model with ModelWriter and reads it back with ModelReader,
+// including inputs that are truncated, misaligned or point out of the file.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "llvm/Support/raw_ostream.h"
+#include "../DerivedType.hpp"
+#include "../ModelArena.hpp"
+#include "../ModelReader.hpp"
+#include "../ModelWriter.hpp"
+#include "../Subprogram.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("%s failed\n", what);
+        ++failures;
+    }
+}
+
+/// \return true if reading the \p size bytes at \p data throws E.
+template <typename E>
+static bool throws(const char *data, size_t size)
+{
+    try {
+        ModelReader reader(data, size);
+        // the records are only checked when they are used
+        for (auto &s : reader.subprograms()) {
+            reader.arguments(s);
+        }
+        return false;
+    } catch (E &) {
+        return true;
+    }
+}
+
+static Variable::Handle variable(ModelArena &arena, const char *name, Variable::Context context,
+                                 llvm::dwarf::TypeKind type, uint64_t size, uint64_t location = 0)
+{
+    Variable::Handle r = arena.make<Variable>();
+    r->name_ = name;
+    r->context_ = context;
+    r->type_ = type;
+    r->elementSize_ = size;
+    r->location_ = location;
+    return r;
+}
+
+int main()
+{
+    ModelArena arena;
+
+    // TYPE POINT with an INTEGER*4 then a REAL*8, 4 bytes of padding between them
+    DerivedType::Handle point = arena.make<DerivedType>();
+    point->name_ = "point";
+    point->byteSize_ = 16;
+    Variable::Handle members[] = {
+        variable(arena, "id", Variable::STRUCTURE_MEMBER, llvm::dwarf::DW_ATE_signed, 4, 0),
+        variable(arena, "f2h_pad0", Variable::STRUCTURE_MEMBER, llvm::dwarf::DW_ATE_unsigned, 1, 4),
+        variable(arena, "x", Variable::STRUCTURE_MEMBER, llvm::dwarf::DW_ATE_float, 8, 8),
+    };
+    Variable::Dimension pad(std::make_pair(0, 3));
+    members[1]->dims_ = arena.copy<Variable::Dimension>(pad);
+    point->members_ = arena.copy<Variable::Handle>(members);
+
+    // SUBROUTINE MOVE(P, V) with TYPE(POINT) P and REAL*8 V(0:3)
+    Subprogram::Handle move = arena.make<Subprogram>();
+    move->name_ = "move";
+    move->linkageName_ = "move_";
+    Variable::Handle args[] = {
+        variable(arena, "p", Variable::PARAMETER, llvm::dwarf::TypeKind(0), 16),
+        variable(arena, "v", Variable::PARAMETER, llvm::dwarf::DW_ATE_float, 8),
+    };
+    args[0]->derived_ = point;
+    Variable::Dimension v(std::make_pair(0, 3));
+    args[1]->dims_ = arena.copy<Variable::Dimension>(v);
+    move->args_ = arena.copy<Variable::Handle>(args);
+    move->returnVal_ = nullptr;
+
+    ModelWriter writer;
+    writer.add(*move);
+    writer.add(*point);
+    // added out of order, the reader finds them by a binary search
+    writer.addModuleVariable(*variable(arena, "__geo_MOD_origin", Variable::MODULE_VARIABLE,
+                                       llvm::dwarf::TypeKind(0), 16));
+    writer.addModuleVariable(*variable(arena, "__geo_MOD_count", Variable::MODULE_VARIABLE,
+                                       llvm::dwarf::DW_ATE_signed, 4));
+
+    std::string binary;
+    llvm::raw_string_ostream os(binary);
+    writer.write(os);
+    os.flush();
+    std::vector<uint64_t> aligned((binary.size() + 7) / 8 + 1);
+    char *data = reinterpret_cast<char *>(aligned.data());
+    std::memcpy(data, binary.data(), binary.size());
+
+    {
+        ModelReader reader(data, binary.size());
+
+        auto sub = reader.findSubprogram("move_");
+        check(sub && reader.arguments(*sub).size() == 2, "subprogram");
+        if (sub && reader.arguments(*sub).size() == 2) {
+            auto &p = reader.arguments(*sub)[0];
+            check(p.derivedType != ModelFormat::none && !std::strcmp(reader.string(p.derivedType), "point"),
+                  "argument of a derived type");
+            auto dims = reader.dimensions(reader.arguments(*sub)[1]);
+            check(dims.size() == 1 && dims[0].known && dims[0].lower == 0 && dims[0].upper == 3, "dimensions");
+        }
+
+        auto type = reader.findDerivedType("point");
+        check(type && type->byteSize == 16 && !std::strcmp(reader.string(type->name), "point"), "derived type");
+        if (type) {
+            auto m = reader.members(*type);
+            check(m.size() == 3, "member count");
+            if (m.size() == 3) {
+                check(!std::strcmp(reader.string(m[0].name), "id") && m[0].location == 0, "first member");
+                check(m[1].type == llvm::dwarf::DW_ATE_unsigned && m[1].location == 4, "padding");
+                check(!std::strcmp(reader.string(m[2].name), "x") && m[2].location == 8 && m[2].elementSize == 8,
+                      "member after the padding");
+                check(m[2].context == ModelFormat::StructureMember, "member context");
+            }
+        }
+        check(!reader.findDerivedType("node"), "missing derived type");
+
+        check(reader.moduleVariables().size() == 2, "module variable count");
+        auto count = reader.findModuleVariable("__geo_MOD_count");
+        check(count && count->elementSize == 4 && count->context == ModelFormat::ModuleVariable, "module variable");
+        auto origin = reader.findModuleVariable("__geo_MOD_origin");
+        check(origin && origin->derivedType == ModelFormat::none, "module variable without a type");
+        check(!reader.findModuleVariable("__geo_MOD_scale"), "missing module variable");
+
+        std::ostringstream js;
+        reader.writeJSON(js);
+        check(js.str().find("\"derivedTypes\":[\n{\"name\":\"point\"") != std::string::npos, "JSON derived types");
+        check(js.str().find("\"moduleVariables\":[\n{\"name\":\"__geo_MOD_count\"") != std::string::npos,
+              "JSON module variables");
+    }
+
+    // every truncation leaves a table or the string table out of the file
+    for (size_t size = 0; size < binary.size(); ++size) {
+        if (!throws<std::runtime_error>(data, size)) {
+            std::printf("a model truncated to %zu of %zu bytes was read\n", size, binary.size());
+            ++failures;
+            break;
+        }
+    }
+
+    // the model must be 8 byte aligned, and so must its tables
+    std::vector<uint64_t> shifted(aligned.size() + 1);
+    char *unaligned = reinterpret_cast<char *>(shifted.data()) + 1;
+    std::memcpy(unaligned, binary.data(), binary.size());
+    check(throws<std::runtime_error>(unaligned, binary.size()), "misaligned model");
+
+    auto header = reinterpret_cast<ModelFormat::Header *>(data);
+    header->derivedTypes.offset += 4;
+    check(throws<std::runtime_error>(data, binary.size()), "misaligned table");
+    header->derivedTypes.offset -= 4;
+
+    header->moduleVariables.recordSize = 40;
+    check(throws<std::runtime_error>(data, binary.size()), "table of another record size");
+    header->moduleVariables.recordSize = sizeof(ModelFormat::Variable);
+
+    header->version = ModelFormat::version - 1;
+    check(throws<std::runtime_error>(data, binary.size()), "older version");
+    header->version = ModelFormat::version;
+
+    auto subprograms = reinterpret_cast<ModelFormat::Subprogram *>(data + header->subprograms.offset);
+    subprograms[0].firstArg = header->variables.count;
+    check(throws<std::out_of_range>(data, binary.size()), "arguments out of the variables");
+
+    return failures != 0;
+}
@@ -0,0 +1,47 @@
+! Functions returning strings and arrays, which write their result to a
+! hidden argument ahead of the others
+
+! 'hello <n>' padded to 8 characters
+character(len=8) function greet(n)
+  implicit none
+  integer(4), intent(in) :: n
+
+  write(greet, '(A,I0)') 'hello ', n
+end function
+
+! S in upper case, the caller passes the length of the result
+function shout(s)
+  implicit none
+  character(len=*), intent(in) :: s
+  character(len=len(s)) :: shout
+  integer(4) :: i
+
+  do i = 1, len(s)
+    shout(i:i) = s(i:i)
+    if (s(i:i) >= 'a' .and. s(i:i) <= 'z') then
+      shout(i:i) = achar(iachar(s(i:i)) - 32)
+    end if
+  end do
+end function
+
+! (X, 2X, 3X)
+real(8) function vec3(x)
+  implicit none
+  dimension vec3(3)
+  real(8), intent(in) :: x
+
+  vec3 = [x, 2*x, 3*x]
+end function
+
+! (1, ..., N), allocated by the function
+function upto(n)
+  implicit none
+  integer(4), intent(in) :: n
+  real(8), allocatable :: upto(:)
+  integer(4) :: i
+
+  allocate(upto(n))
+  do i = 1, n
+    upto(i) = i
+  end do
+end function
@@ -0,0 +1,55 @@
+// Calls results.f90 through the --cxx-results overloads, which size the
+// caller's string or describe the caller's array as the hidden result
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "results.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("%s failed\n", what);
+        ++failures;
+    }
+}
+
+int main()
+{
+    // resized to the fixed length of the result
+    std::string s;
+    int32_t n = 7;
+    greet_(s, &n);
+    check(s == "hello 7 ", "fixed length string result");
+
+    // reused without being reallocated
+    const char *data = s.data();
+    n = 42;
+    greet_(s, &n);
+    check(s == "hello 42" && s.data() == data, "reused string result");
+
+    // the result is as long as the caller's string, the argument is a char_arg
+    std::string upper(5, ' ');
+    shout_(upper, "abc1z");
+    check(upper == "ABC1Z", "string result of the caller's length");
+
+    // described by a descriptor on the stack
+    double v[3] = { 0, 0, 0 };
+    double x = 1.5;
+    vec3_(v, {3}, &x);
+    check(v[0] == 1.5 && v[1] == 3 && v[2] == 4.5, "array result");
+
+    // an ALLOCATABLE result has no overload, the function allocates it
+    f2h_array_r1 d = {};
+    n = 4;
+    upto_(&d, &n);
+    check(d.base_addr && d.dim[0].lower_bound == 1 && d.dim[0].upper_bound == 4, "allocatable result");
+    if (d.base_addr) {
+        double *u = static_cast<double *>(d.base_addr);
+        check(u[0] == 1 && u[3] == 4, "allocatable result elements");
+        std::free(d.base_addr);
+    }
+
+    return failures != 0;
+}
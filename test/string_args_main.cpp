@@ -0,0 +1,58 @@
+// Calls strings.f through the --cxx-strings overloads, which pass the
+// lengths of the CHARACTER arguments after all the other arguments
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "string_args.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("%s failed\n", what);
+        ++failures;
+    }
+}
+
+int main()
+{
+    char c = 0;
+    int32_t l = 0;
+
+    // a literal loses its terminator
+    string_test_(c, &l, "hello");
+    check(l == 5 && c == 'h', "string literal");
+
+    // a char array is passed whole
+    char buffer[8] = "abc";
+    string_test_(c, &l, buffer);
+    check(l == 8 && c == 'a', "char array");
+
+    const std::string constant("xyz1");
+    string_test_(c, &l, constant);
+    check(l == 4 && c == 'x', "const std::string");
+
+    string_test_(c, &l, f2h::char_arg("qrstuv", 2));
+    check(l == 2 && c == 'q', "pointer and length");
+
+    // C isn't INTENT(IN), FORTRAN writes to the string
+    std::string out(1, ' ');
+    string_test_(out, &l, "k");
+    check(l == 1 && out == "k", "std::string written by FORTRAN");
+
+    // each element of an array of strings has the length passed
+    char sa[3][2] = { {'a', 'x'}, {'b', 'x'}, {'c', 'x'} };
+    int8_t ic[3] = {};
+    string_array_test_(ic, f2h::char_arg(&sa[0][0], 2));
+    check(ic[0] == 'a' && ic[1] == 'b' && ic[2] == 'c', "array of strings");
+
+    // the lengths follow N and M in the order of the strings
+    int32_t n = 0, m = 0;
+    std::string b(6, '?');
+    string_order_test_("abc", &n, b, &m);
+    check(n == 3 && m == 6, "length order");
+    check(b == "abc   ", "std::string B written by FORTRAN");
+
+    return failures != 0;
+}
@@ -43,3 +43,19 @@
 
       END
       
+
+!     Takes two strings of unknown length around an integer, the lengths are
+!     passed after all the arguments.  Sets N and M to their lengths and
+!     copies A to B, which is not INTENT(IN)
+      SUBROUTINE STRING_ORDER_TEST(A, N, B, M)
+
+      IMPLICIT NONE
+
+      CHARACTER*(*) A, B
+      INTEGER*4 N, M
+
+      N = LEN(A)
+      M = LEN(B)
+      B = A
+
+      END
@@ -0,0 +1,78 @@
+! Derived types of modules for the checks of the structs f2h declares
+
+module geo
+  implicit none
+
+  ! padded after id
+  type point
+    integer(4) :: id
+    real(8) :: x, y
+  end type
+
+  ! nested, with padding at the end
+  type segment
+    type(point) :: a, b
+    logical(1) :: closed
+  end type
+
+  ! has an allocatable array of itself
+  type node
+    integer(4) :: value
+    type(node), allocatable :: kids(:)
+  end type
+
+  type(segment), target :: seg
+  type(node), target :: root
+end module
+
+module other
+  implicit none
+
+  ! the name of geo's point with another layout
+  type point
+    real(4) :: x, y, z
+  end type
+
+  type(point), target :: corner
+end module
+
+! Sets some members of the module variables and returns the sizes and the
+! member offsets of the types as FORTRAN has them, sizes in the order point,
+! segment, node, other's point and offsets in the order of the members.
+! The offset of the descriptor in node is left out, it has no address
+! while kids isn't allocated.
+subroutine type_layout(sizes, offsets)
+  use iso_c_binding
+  use geo
+  use other, only: corner
+  implicit none
+  integer(8), intent(out) :: sizes(4), offsets(10)
+
+  seg%b%y = 2.5d0
+  seg%closed = .true.
+  root%value = 7
+  corner%z = 1.5
+
+  sizes(1) = storage_size(seg%a) / 8
+  sizes(2) = storage_size(seg) / 8
+  sizes(3) = storage_size(root) / 8
+  sizes(4) = storage_size(corner) / 8
+
+  offsets(1) = diff(c_loc(seg%a%id), c_loc(seg%a))
+  offsets(2) = diff(c_loc(seg%a%x), c_loc(seg%a))
+  offsets(3) = diff(c_loc(seg%a%y), c_loc(seg%a))
+  offsets(4) = diff(c_loc(seg%a), c_loc(seg))
+  offsets(5) = diff(c_loc(seg%b), c_loc(seg))
+  offsets(6) = diff(c_loc(seg%closed), c_loc(seg))
+  offsets(7) = diff(c_loc(root%value), c_loc(root))
+  offsets(8) = diff(c_loc(corner%x), c_loc(corner))
+  offsets(9) = diff(c_loc(corner%y), c_loc(corner))
+  offsets(10) = diff(c_loc(corner%z), c_loc(corner))
+
+contains
+
+  integer(8) function diff(a, b)
+    type(c_ptr), intent(in) :: a, b
+    diff = transfer(a, 0_c_intptr_t) - transfer(b, 0_c_intptr_t)
+  end function
+end subroutine
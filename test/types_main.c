@@ -0,0 +1,52 @@
+/* Checks the structs f2h declares for the derived types of types.f90
+   against the sizes and offsets FORTRAN has for them */
+#include <stddef.h>
+#include <stdio.h>
+#include "types.h"
+
+static int failures = 0;
+
+static void check(long long c, long long fortran, const char *what)
+{
+    if (c != fortran) {
+        printf("%s is %lld in C, %lld in FORTRAN\n", what, c, fortran);
+        ++failures;
+    }
+}
+
+int main()
+{
+    int64_t sizes[4], offsets[10];
+    type_layout_(sizes, offsets);
+
+    /* padded after id */
+    check(sizeof(struct point), sizes[0], "sizeof(struct point)");
+    check(offsetof(struct point, id), offsets[0], "offsetof(struct point, id)");
+    check(offsetof(struct point, x), offsets[1], "offsetof(struct point, x)");
+    check(offsetof(struct point, y), offsets[2], "offsetof(struct point, y)");
+
+    /* nested, padded at the end */
+    check(sizeof(struct segment), sizes[1], "sizeof(struct segment)");
+    check(offsetof(struct segment, a), offsets[3], "offsetof(struct segment, a)");
+    check(offsetof(struct segment, b), offsets[4], "offsetof(struct segment, b)");
+    check(offsetof(struct segment, closed), offsets[5], "offsetof(struct segment, closed)");
+
+    /* an allocatable array of itself */
+    check(sizeof(struct node), sizes[2], "sizeof(struct node)");
+    check(offsetof(struct node, value), offsets[6], "offsetof(struct node, value)");
+
+    /* other's point, renamed since geo's has another layout */
+    check(sizeof(struct point_2), sizes[3], "sizeof(struct point_2)");
+    check(offsetof(struct point_2, x), offsets[7], "offsetof(struct point_2, x)");
+    check(offsetof(struct point_2, y), offsets[8], "offsetof(struct point_2, y)");
+    check(offsetof(struct point_2, z), offsets[9], "offsetof(struct point_2, z)");
+
+    /* the module variables are the ones FORTRAN wrote to */
+    check(__geo_MOD_seg.b.y == 2.5, 1, "seg%b%y");
+    check(__geo_MOD_seg.closed != 0, 1, "seg%closed");
+    check(__geo_MOD_root.value, 7, "root%value");
+    check(__geo_MOD_root.kids.base_addr == NULL, 1, "root%kids unallocated");
+    check(__other_MOD_corner.z == 1.5f, 1, "corner%z");
+
+    return failures != 0;
+}
@@ -0,0 +1,26 @@
+      SUBROUTINE BOUNDS_TEST(A, V)
+
+      implicit none
+      COMMON /BOUNDS_COMMON/ C
+      REAL*8 A, C
+      INTEGER V
+      DIMENSION A(0:3,-1:2), C(-1:1,2:4), V(-2:2)
+      INTEGER I, J
+
+      DO 10 J = -1,2
+         DO 20 I = 0,3
+            A(I,J) = 10*I + J
+ 20      CONTINUE
+ 10   CONTINUE
+
+      DO 30 I = -2,2
+         V(I) = I
+ 30   CONTINUE
+
+      DO 40 J = 2,4
+         DO 50 I = -1,1
+            C(I,J) = 10*I + J
+ 50      CONTINUE
+ 40   CONTINUE
+      
+      END
@@ -0,0 +1,42 @@
+// Checks that the --cxx-views of views.f index the same elements as FORTRAN
+#include <cstdio>
+#include "views.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, int i, int j)
+{
+    if (!ok) {
+        std::printf("%s(%d,%d) is not the FORTRAN element\n", what, i, j);
+        ++failures;
+    }
+}
+
+int main()
+{
+    double a[4][4] = {};
+    int32_t v[5] = {};
+    bounds_test_(&a[0][0], v);
+
+    f2h::bounds_test_::a av(&a[0][0]);
+    for (int j = -1; j <= 2; ++j) {
+        for (int i = 0; i <= 3; ++i) {
+            check(av(i, j) == 10*i + j, "a", i, j);
+            check(&av(i, j) == &a[j + 1][i], "a", i, j);
+        }
+    }
+
+    f2h::bounds_test_::v vv(v);
+    for (int i = -2; i <= 2; ++i) {
+        check(vv(i) == i, "v", i, 0);
+    }
+
+    auto cv = f2h::bounds_common_::c();
+    for (int j = 2; j <= 4; ++j) {
+        for (int i = -1; i <= 1; ++i) {
+            check(cv(i, j) == 10*i + j, "c", i, j);
+        }
+    }
+
+    return failures != 0;
+}